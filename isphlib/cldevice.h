@@ -59,6 +59,11 @@ namespace isph
 		 */
       const std::string& Vendor() { return vendor; }
 
+		/*!
+		 *	\brief	Get the OpenCL driver version.
+		 */
+      const std::string& DriverVersion() { return driverVersion; }
+
 		/*!
 		 *	\brief	Get the number of compute units.
 		 */
@@ -89,6 +94,11 @@ namespace isph
 		 */
       bool GlobalAtomics() { return globalAtomics; }
 
+		/*!
+		 *	\brief	Check if device supports 64-bit atomic functions in global memory.
+		 */
+      bool GlobalAtomics64() { return globalAtomics64; }
+
 		/*!
 		 *	\brief	Check if device supports atomic functions in local memory.
 		 */
@@ -137,6 +147,7 @@ namespace isph
       cl_device_type type = CL_DEVICE_TYPE_DEFAULT;
 		std::string name;
 		std::string vendor;
+		std::string driverVersion;
       cl_uint maxComputeUnits = 0;
       cl_uint maxClock = 0;
       cl_uint performanceIndex = 0;
@@ -148,6 +159,7 @@ namespace isph
       bool fp16 = false;
       bool fp64 = false;
       bool globalAtomics = false;
+      bool globalAtomics64 = false;
       bool localAtomics = false;
 	};
 
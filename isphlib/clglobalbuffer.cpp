@@ -2,6 +2,7 @@
 #include <string>
 #include <float.h>
 #include <cstring>
+#include <algorithm>
 
 using namespace isph;
 
@@ -13,6 +14,7 @@ CLGlobalBuffer::CLGlobalBuffer(CLProgram *program, const std::string &semantic)
 	, offsets(NULL)
 	, hostHasData(false)
 	, hostDataChanged(false)
+	, downloadEvents(NULL)
 {
 }
 
@@ -28,6 +30,10 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 	if(needsUpdate)
 		if(!Allocate())
 			return false;
+
+	// host reads device data, so what it does next isn't known before
+	if(parentProgram)
+		parentProgram->InvalidateRecording();
 	
     LogDebug("Reading variable: " + semantics.front());
 
@@ -40,6 +46,10 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 		}
 	}
 
+	// previous read still writes to host data
+	if(!WaitForDownload())
+		return false;
+
 	if(hostHasData && !forceDownload)
 		return true;
 
@@ -53,9 +63,7 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 	}
 
 	cl_int status = 0;
-	cl_event* events = NULL;
-	if(CLSystem::Instance()->Profiling() || waitToFinish)
-		events = new cl_event[bufferCount];
+	cl_event* events = new cl_event[bufferCount];
 
 	// enqueue read data from all devices
 	for (unsigned int i=0; i<bufferCount; i++)
@@ -67,10 +75,7 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 		else
 			status = clEnqueueReadBuffer(parentProgram->Link()->Queue(i), clBuffers[i], CL_FALSE, 0, ElementCount(i)*typeSize, offsetPos, 0, NULL, &events[i]);*/
 		
-		if(events)
-			status = clEnqueueReadBuffer(parentProgram->Link()->Queue(i), clBuffers[i], CL_FALSE, 0, memorySize, data, 0, NULL, &events[i]);
-		else
-			status = clEnqueueReadBuffer(parentProgram->Link()->Queue(i), clBuffers[i], CL_FALSE, 0, memorySize, data, 0, NULL, NULL);
+		status = clEnqueueReadBuffer(parentProgram->Link()->Queue(i), clBuffers[i], CL_FALSE, 0, memorySize, data, 0, NULL, &events[i]);
 
 		if(status)
 		{
@@ -87,7 +92,7 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 			cl_ulong timeStart, timeEnd;
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &timeStart, NULL);
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &timeEnd, NULL);
-			Log::Send(Log::DebugInfo, Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
+			LogMessage(Log::DebugInfo, Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
 			clReleaseEvent(events[i]);
 		}
 		delete [] events;
@@ -106,6 +111,8 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 			return false;
 		}
 	}
+	else
+		downloadEvents = events;
 
 	hostHasData = true;
 	hostDataChanged = false;
@@ -114,12 +121,36 @@ bool CLGlobalBuffer::Download(bool waitToFinish, bool forceDownload)
 }
 
 
+bool CLGlobalBuffer::WaitForDownload()
+{
+	if(!downloadEvents)
+		return true;
+
+	cl_int status = clWaitForEvents(bufferCount, downloadEvents);
+	for (unsigned int i=0; i<bufferCount; i++)
+		clReleaseEvent(downloadEvents[i]);
+	delete [] downloadEvents;
+	downloadEvents = NULL;
+
+	if(status)
+	{
+		Log::Send(Log::Error, CLSystem::Instance()->ErrorDesc(status));
+		return false;
+	}
+
+	return true;
+}
+
+
 bool CLGlobalBuffer::Upload(bool waitToFinish)
 {
 	if(needsUpdate)
 		if(!Allocate())
 			return false;
 
+	if(!WaitForDownload())
+		return false;
+
 	if(!data || !hostHasData)
 		return true;
 
@@ -137,6 +168,8 @@ bool CLGlobalBuffer::Upload(bool waitToFinish)
 		return false;
 	}
 
+	parentProgram->InvalidateRecording();
+
 	cl_int status;
 	cl_event* events = NULL;
 	if(CLSystem::Instance()->Profiling() || waitToFinish)
@@ -168,7 +201,7 @@ bool CLGlobalBuffer::Upload(bool waitToFinish)
 			cl_ulong timeStart, timeEnd;
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &timeStart, NULL);
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &timeEnd, NULL);
-			Log::Send(Log::DebugInfo, Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
+			LogMessage(Log::DebugInfo, Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
 			clReleaseEvent(events[i]);
 		}
 		delete [] events;
@@ -197,20 +230,27 @@ bool CLGlobalBuffer::Upload(bool waitToFinish)
 
 bool CLGlobalBuffer::CopyFrom(CLGlobalBuffer* var, bool waitToFinish)
 {
-	LogDebug("Copying variable: " + var->semantics.front() + ", to variable: " + semantics.front());
-
 	if(!var)
 	{
 		Log::Send(Log::Error, "Cannot copy from NULL variable.");
 		return false;
 	}
 
+	LogDebug("Copying variable: " + var->semantics.front() + ", to variable: " + semantics.front());
+
 	if(!memorySize || !parentProgram || !clBuffers)
 	{
 		Log::Send(Log::Error, "Cannot write to uninitialized OpenCL buffer.");
 		return false;
 	}
 
+	if(parentProgram->IsRecording())
+	{
+		CLProgram::RecordedCommand& command = parentProgram->Record(CLProgram::RecordedCopy);
+		command.destination = this;
+		command.source = var;
+	}
+
 	cl_int status;
 	cl_event* events = NULL;
 	if(CLSystem::Instance()->Profiling() || waitToFinish)
@@ -238,7 +278,7 @@ bool CLGlobalBuffer::CopyFrom(CLGlobalBuffer* var, bool waitToFinish)
 			cl_ulong timeStart, timeEnd;
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &timeStart, NULL);
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &timeEnd, NULL);
-			Log::Send(Log::DebugInfo, Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
+			LogMessage(Log::DebugInfo, Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
 			clReleaseEvent(events[i]);
 		}
 		delete [] events;
@@ -264,11 +304,49 @@ bool CLGlobalBuffer::CopyFrom(CLGlobalBuffer* var, bool waitToFinish)
 	return true;
 }
 
+bool CLGlobalBuffer::SwapWith(CLGlobalBuffer* var)
+{
+	if(!var)
+	{
+		Log::Send(Log::Error, "Cannot swap with NULL variable.");
+		return false;
+	}
+
+	LogDebug("Swapping variable: " + var->semantics.front() + ", with variable: " + semantics.front());
+
+	if(!clBuffers || !var->clBuffers)
+	{
+		Log::Send(Log::Error, "Cannot swap uninitialized OpenCL buffers.");
+		return false;
+	}
+
+	if(varDataType != var->varDataType || elementCount != var->elementCount || bufferCount != var->bufferCount)
+	{
+		Log::Send(Log::Error, "Cannot swap OpenCL buffers of different types or sizes.");
+		return false;
+	}
+
+	// pending reads write to host data of their buffer
+	if(!WaitForDownload() || !var->WaitForDownload())
+		return false;
+
+	std::swap(clBuffers, var->clBuffers);
+	std::swap(data, var->data);
+	std::swap(hostHasData, var->hostHasData);
+	std::swap(hostDataChanged, var->hostDataChanged);
+
+	return true;
+}
+
 
 bool CLGlobalBuffer::Allocate()
 {
 	bool allocateHost = data ? false : true;
 
+	// recorded commands are bound to buffers released here
+	if(parentProgram)
+		parentProgram->InvalidateRecording();
+
 	Release();
 
 	LogDebug("Allocating on device buffer: " + semantics.front());
@@ -362,6 +440,8 @@ bool CLGlobalBuffer::SetAsArgument(CLSubProgram *kernel, unsigned int argID, uns
 
 void CLGlobalBuffer::Release()
 {
+	WaitForDownload();
+
 	cl_int status;
 	if(clBuffers)
 	{
@@ -415,6 +495,9 @@ bool CLGlobalBuffer::AllocateHostData()
 
 double CLGlobalBuffer::GetScalar( unsigned int id )
 {
+	if(!WaitForDownload())
+		return DBL_MAX;
+
 	if(!hostHasData)
 		if(!Download())
 			return DBL_MAX;
@@ -424,6 +507,9 @@ double CLGlobalBuffer::GetScalar( unsigned int id )
 
 Vec<3,double> CLGlobalBuffer::GetVector(unsigned int id)
 {
+	if(!WaitForDownload())
+		return DBL_MAX;
+
 	if(!hostHasData)
 		if(!Download())
 			return DBL_MAX;
@@ -437,6 +523,9 @@ bool CLGlobalBuffer::SetScalar( unsigned int id, double var )
 		if(!AllocateHostData())
 			return false;
 
+	if(!WaitForDownload())
+		return false;
+
 	if(!hostHasData)
 		if(!Download())
 			return false;
@@ -454,6 +543,9 @@ bool CLGlobalBuffer::SetVector( unsigned int id, Vec<3,double> var )
 		if(!AllocateHostData())
 			return false;
 
+	if(!WaitForDownload())
+		return false;
+
 	if(!hostHasData)
 		if(!Download())
 			return false;
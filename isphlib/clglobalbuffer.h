@@ -16,6 +16,9 @@ namespace isph
 		CLGlobalBuffer(CLProgram* program, const std::string& semantic);
 		virtual ~CLGlobalBuffer();
 
+		/*!
+		 *	\brief	Get host copy of the data, without waiting for download that didn't wait to finish.
+		 */
 		inline void* HostData() { return data; }
 
 		inline bool HostHasData() { return hostHasData; }
@@ -25,9 +28,15 @@ namespace isph
 		/*!
 		 *	\brief	Read the data from devices to the host.
 		 *	\param	waitToFinish Wait for reading to finish before returning from function.
+		 *	\remarks Without waiting, getting or setting values waits for the read first.
 		 */
 		bool Download(bool waitToFinish = true, bool forceDownload = false);
 
+		/*!
+		 *	\brief	Wait for reading started by Download that didn't wait to finish.
+		 */
+		bool WaitForDownload();
+
 		/*!
 		 *	\brief	Write the data from host to devices.
 		 *	\param	waitToFinish Wait for writing to finish before returning from function.
@@ -41,6 +50,13 @@ namespace isph
 		 */
 		bool CopyFrom(CLGlobalBuffer* var, bool waitToFinish = true);
 
+		/*!
+		 *	\brief	Exchange data with another buffer of the same type and size, without copying.
+		 *	\remarks Kernels that had any of the buffers as argument need to set their arguments again.
+		 *	\param	var	Variable whose device and host data will be exchanged with this variable.
+		 */
+		bool SwapWith(CLGlobalBuffer* var);
+
 		virtual bool SetScalar(unsigned int id, double var);
 		bool SetScalar(double var) { return SetScalar(0, var); }
 
@@ -75,6 +91,7 @@ namespace isph
 		bool AllocateHostData();
 		bool hostHasData;
 		bool hostDataChanged;
+		cl_event* downloadEvents; // read that host hasn't waited for yet
 
 	};
 
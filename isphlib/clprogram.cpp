@@ -2,6 +2,17 @@
 using namespace isph;
 
 #include <sstream>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <ctime>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 CLProgram::CLProgram()
 	: link(NULL)
@@ -11,6 +22,8 @@ CLProgram::CLProgram()
    , normalMath(true)
 	, isBuilt(false)
 	, program(NULL)
+	, recording(false)
+	, recordReplayable(false)
 {
 	CLLocalBuffer *var;
 	var = new CLLocalBuffer(this, "LOCAL_SIZE_UINT");  var->SetSpace(UintType, 0);
@@ -102,26 +115,20 @@ bool CLProgram::Build()
 		source.append("#define " + it->first + " (" + it->second->CLSource() + ")\n");
 	}
 
+	// unreachable subprograms aren't compiled at all
+	unsigned int pruned = 0;
 	for(size_t i=0; i<subprograms.size(); i++)
 	{
-		source.append(subprograms[i]->source);
+		if(subprograms[i]->IsEnabled())
+			source.append(subprograms[i]->source);
+		else
+			pruned++;
 	}
+	if(pruned)
+		LogDebug("Subprograms left out of build: " + Utils::IntegerString(pruned));
 
 	//Log::Send(Log::Info, source);
 
-	cl_int status;
-
-	// create CL program
-	const char* source_cstring = source.c_str();
-	size_t source_size = source.size();
-	program = clCreateProgramWithSource(link->context, 1, &source_cstring, &source_size, &status); 
-
-	if(status)
-	{
-		Log::Send(Log::Error, CLSystem::Instance()->ErrorDesc(status));
-		return false;
-	}
-
 	// set build options
 	std::string buildOptionsStr;
    buildOptionsStr = "-cl-no-signed-zeros";
@@ -137,9 +144,28 @@ bool CLProgram::Build()
 	for(size_t i=0; i<buildOptions.size(); i++)
 		buildOptionsStr.append(' ' + buildOptions[i]);
 
-	// build on our link (devices)
-	if(!link->BuildProgram(program, buildOptionsStr))
-		return false;
+	// reuse binaries of the same program built by earlier runs
+	bool cached = !binaryCache.empty() && LoadCachedBinaries(buildOptionsStr);
+
+	if(!cached)
+	{
+		cl_int status;
+
+		// create CL program
+		const char* source_cstring = source.c_str();
+		size_t source_size = source.size();
+		program = clCreateProgramWithSource(link->context, 1, &source_cstring, &source_size, &status); 
+
+		if(status)
+		{
+			Log::Send(Log::Error, CLSystem::Instance()->ErrorDesc(status));
+			return false;
+		}
+
+		// build on our link (devices)
+		if(!link->BuildProgram(program, buildOptionsStr))
+			return false;
+	}
 
 	// init the variables for devices
 	for (std::map<std::string,CLVariable*>::iterator it=variables.begin() ; it != variables.end(); it++)
@@ -155,7 +181,7 @@ bool CLProgram::Build()
 	// create kernels
 	for(size_t i=0; i<subprograms.size(); i++)
 	{
-		if(subprograms[i]->IsKernel())
+		if(subprograms[i]->IsKernel() && subprograms[i]->IsEnabled())
 			if(!subprograms[i]->CreateKernel())
 			{
 				Log::Send(Log::Error, "Error while creating kernel: " + subprograms[i]->KernelName());
@@ -164,9 +190,114 @@ bool CLProgram::Build()
 	}
 
 	isBuilt = true;
+
+	if(!cached && !binaryCache.empty())
+		StoreCachedBinaries(buildOptionsStr);
+
 	return isBuilt;
 }
 
+void CLProgram::SetBinaryCache(const std::string& directory)
+{
+	binaryCache = directory;
+}
+
+std::string CLProgram::CachedBinaryPath(const std::string& buildOptions, unsigned int device)
+{
+	CLDevice* dev = link->Device(device);
+
+	// 64-bit FNV-1a hash of everything the compiled binary depends on
+	std::string key = source + '\n' + buildOptions + '\n' + dev->Name() + '\n' + dev->Vendor() + '\n'
+		+ dev->DriverVersion() + '\n' + link->Platform()->CLVersion();
+	unsigned long long hash = 14695981039346656037ULL;
+	for(size_t i=0; i<key.size(); i++)
+	{
+		hash ^= (unsigned char)key[i];
+		hash *= 1099511628211ULL;
+	}
+
+	std::stringstream path;
+	path << binaryCache;
+	char last = binaryCache[binaryCache.size() - 1];
+	if(last != '/' && last != '\\')
+		path << '/';
+	path << std::hex << hash << ".bin";
+	return path.str();
+}
+
+bool CLProgram::LoadCachedBinaries(const std::string& buildOptions)
+{
+	unsigned int count = link->DeviceCount();
+	std::vector<std::string> binaries(count);
+	std::vector<const unsigned char*> pointers(count);
+	std::vector<size_t> sizes(count);
+	std::vector<cl_device_id> ids(count);
+
+	for(unsigned int i=0; i<count; i++)
+	{
+		std::ifstream file(CachedBinaryPath(buildOptions, i).c_str(), std::ios::binary);
+		if(!file)
+			return false;
+		binaries[i].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		if(binaries[i].empty())
+			return false;
+		pointers[i] = (const unsigned char*)binaries[i].data();
+		sizes[i] = binaries[i].size();
+		ids[i] = link->Device(i)->ID();
+	}
+
+	cl_int status;
+	std::vector<cl_int> binaryStatus(count);
+	program = clCreateProgramWithBinary(link->context, count, &ids[0], &sizes[0], &pointers[0], &binaryStatus[0], &status);
+	if(status)
+	{
+		LogDebug("Cached program binaries rejected, building from source");
+		program = NULL;
+		return false;
+	}
+
+	// binaries still need to be built (linked) for devices
+	if(!link->BuildProgram(program, buildOptions))
+	{
+		Log::Send(Log::Warning, "Building cached program binaries failed, building from source");
+		clReleaseProgram(program);
+		program = NULL;
+		return false;
+	}
+
+	Log::Send(Log::Info, "Program loaded from binary cache: " + binaryCache);
+	return true;
+}
+
+void CLProgram::StoreCachedBinaries(const std::string& buildOptions)
+{
+	// runs storing the same cache at once must not share temporary files
+	std::stringstream unique;
+	unique << '.' << getpid() << '.' << time(NULL) << '.' << this;
+
+	for(unsigned int i=0; i<link->DeviceCount(); i++)
+	{
+		std::string binary = CompiledBinary(i);
+		if(binary.empty())
+			continue;
+
+		// other runs may read the cache, so binary is written aside and then renamed
+		std::string path = CachedBinaryPath(buildOptions, i);
+		std::string tempPath = path + unique.str();
+		std::ofstream file(tempPath.c_str(), std::ios::binary);
+		file.write(binary.data(), binary.size());
+		file.close();
+
+		if(!file)
+		{
+			Log::Send(Log::Warning, "Couldn't write program binary to cache: " + tempPath);
+			remove(tempPath.c_str());
+		}
+		else if(rename(tempPath.c_str(), path.c_str()))
+			remove(tempPath.c_str());
+	}
+}
+
 bool CLProgram::Finish()
 {
 	if(!isBuilt)
@@ -261,6 +392,15 @@ bool CLProgram::ConnectSemantic(const std::string& semantic, CLVariable* var, bo
 		return false;
 	}
 
+	// replay connects it again, since it might be connected differently by then
+	if(recording)
+	{
+		RecordedCommand& command = Record(RecordedConnect);
+		command.semantic = semantic;
+		command.variable = var;
+		command.autoUpdate = autoUpdateKernelsIfNeeded;
+	}
+
 	std::map<std::string,CLVariable*>::iterator found = variables.find(semantic);
 	
 	if(found != variables.end())
@@ -284,14 +424,161 @@ bool CLProgram::ConnectSemantic(const std::string& semantic, CLVariable* var, bo
 	var->semantics.push_back(semantic);
 
 	// if called at run-time of program, update kernels that depend on this semantic
-	if(autoUpdateKernelsIfNeeded && var->Type() == GlobalBuffer && isBuilt)
+	if(isBuilt)
 	{
 		for(unsigned int i=0; i<subprograms.size(); i++)
 		{
 			int semi = subprograms[i]->SemanticIndex(semantic);
-			if(semi >= 0)
-				//Variable(semantic)->SetAsArgument(subprograms[i], i);
-				subprograms[i]->SetPersistentArguments(); /// \todo
+			if(semi >= 0 && subprograms[i]->IsEnabled())
+			{
+				if(autoUpdateKernelsIfNeeded && var->Type() == GlobalBuffer)
+					//Variable(semantic)->SetAsArgument(subprograms[i], i);
+					subprograms[i]->SetPersistentArguments(); /// \todo
+				else
+					subprograms[i]->ResolveArguments();
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CLProgram::SwapBuffers(const std::string& semantic1, const std::string& semantic2)
+{
+	CLGlobalBuffer* buffer1 = Buffer(semantic1);
+	CLGlobalBuffer* buffer2 = Buffer(semantic2);
+
+	if(!buffer1 || !buffer2)
+	{
+		Log::Send(Log::Error, "Cannot swap buffers: " + semantic1 + ", " + semantic2);
+		return false;
+	}
+
+	return SwapBuffers(buffer1, buffer2);
+}
+
+bool CLProgram::SwapBuffers(CLGlobalBuffer* buffer1, CLGlobalBuffer* buffer2)
+{
+	if(!buffer1 || !buffer2)
+	{
+		Log::Send(Log::Error, "Cannot swap NULL buffers.");
+		return false;
+	}
+
+	if(buffer1 == buffer2)
+		return true;
+
+	if(recording)
+	{
+		RecordedCommand& command = Record(RecordedSwap);
+		command.destination = buffer1;
+		command.source = buffer2;
+	}
+
+	if(!buffer1->SwapWith(buffer2))
+		return false;
+
+	// kernels hold memory objects as arguments, update those that use any semantic of swapped buffers
+	if(isBuilt)
+	{
+		for(unsigned int i=0; i<subprograms.size(); i++)
+		{
+			if(!subprograms[i]->IsEnabled())
+				continue;
+			bool uses = false;
+			for(std::list<std::string>::iterator it=buffer1->semantics.begin(); !uses && it!=buffer1->semantics.end(); it++)
+				uses = subprograms[i]->SemanticIndex(*it) >= 0;
+			for(std::list<std::string>::iterator it=buffer2->semantics.begin(); !uses && it!=buffer2->semantics.end(); it++)
+				uses = subprograms[i]->SemanticIndex(*it) >= 0;
+			if(uses && !subprograms[i]->SetPersistentArguments())
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void CLProgram::StartRecording()
+{
+	record.clear();
+	recording = true;
+	recordReplayable = true;
+}
+
+bool CLProgram::StopRecording()
+{
+	recording = false;
+	return recordReplayable;
+}
+
+CLProgram::RecordedCommand& CLProgram::Record(RecordedCommandType type)
+{
+	record.push_back(RecordedCommand());
+	RecordedCommand& command = record.back();
+	command.type = type;
+	command.subprogram = NULL;
+	command.globalSize = command.localSize = 0;
+	command.destination = command.source = NULL;
+	command.variable = NULL;
+	command.autoUpdate = true;
+	command.hostCommand = NULL;
+	command.hostData = NULL;
+	return command;
+}
+
+bool CLProgram::RunHostCommand(CLHostCommand command, void* data)
+{
+	if(!recording)
+		return command(data);
+
+	RecordedCommand& recorded = Record(RecordedHostCommand);
+	recorded.hostCommand = command;
+	recorded.hostData = data;
+
+	recording = false;
+	bool success = command(data);
+	recording = true;
+	return success;
+}
+
+bool CLProgram::Replay()
+{
+	if(!CanReplay())
+	{
+		Log::Send(Log::Error, "There are no replayable recorded commands.");
+		return false;
+	}
+
+	for(size_t i=0; i<record.size(); i++)
+	{
+		RecordedCommand& command = record[i];
+		bool success = false;
+
+		// restore kernel arguments host has changed since recording
+		for(size_t j=0; j<command.argumentValues.size(); j++)
+		{
+			CLVariable* var = command.argumentValues[j].first;
+			const std::string& value = command.argumentValues[j].second;
+			if(memcmp(var->data, value.data(), value.size()))
+			{
+				memcpy(var->data, value.data(), value.size());
+				var->dataChanges++;
+			}
+		}
+
+		switch(command.type)
+		{
+		case RecordedKernel:		success = command.subprogram->Enqueue(command.globalSize, command.localSize); break;
+		case RecordedCopy:			success = command.destination->CopyFrom(command.source, false); break;
+		case RecordedSwap:			success = SwapBuffers(command.destination, command.source); break;
+		case RecordedConnect:		success = ConnectSemantic(command.semantic, command.variable, command.autoUpdate); break;
+		case RecordedHostCommand:	success = command.hostCommand(command.hostData); break;
+		}
+
+		if(!success)
+		{
+			Log::Send(Log::Error, "Replaying recorded commands failed.");
+			return false;
 		}
 	}
 
@@ -306,14 +593,42 @@ size_t CLProgram::UsedMemorySize()
 	return bytes;
 }
 
-std::string CLProgram::CompiledBinary()
+std::string CLProgram::CompiledBinary(unsigned int device)
 {
-	/// \todo retrieve binary for each device, when multi-device implemented
-	if(!isBuilt)
+	if(!isBuilt || device >= link->DeviceCount())
+		return "";
+
+	// binaries are listed in order of program devices
+	cl_uint count;
+	cl_int status = clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &count, NULL);
+	if(status || !count)
+		return "";
+
+	std::vector<cl_device_id> ids(count);
+	std::vector<size_t> sizes(count);
+	status = clGetProgramInfo(program, CL_PROGRAM_DEVICES, count * sizeof(cl_device_id), &ids[0], NULL);
+	status |= clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, count * sizeof(size_t), &sizes[0], NULL);
+	if(status)
+		return "";
+
+	std::vector<std::string> binaries(count);
+	std::vector<unsigned char*> pointers(count);
+	for(cl_uint i=0; i<count; i++)
+	{
+		binaries[i].resize(sizes[i]);
+		pointers[i] = sizes[i] ? (unsigned char*)&binaries[i][0] : NULL;
+	}
+
+	status = clGetProgramInfo(program, CL_PROGRAM_BINARIES, count * sizeof(unsigned char*), &pointers[0], NULL);
+	if(status)
+	{
+		Log::Send(Log::Error, CLSystem::Instance()->ErrorDesc(status));
 		return "";
-	size_t binarySize;
-	cl_int status = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binarySize, NULL);
-	char *binary = new char[binarySize + 1];
-	status = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(char*), &binary, NULL);
-	return binary;
+	}
+
+	for(cl_uint i=0; i<count; i++)
+		if(ids[i] == link->Device(device)->ID())
+			return binaries[i];
+
+	return "";
 }
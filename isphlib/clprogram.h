@@ -24,6 +24,11 @@ namespace isph {
 	class CLProgramConstant;
 	class CLLink;
 
+	/*!
+	 *	\brief	Function run by host when replaying recorded commands, for work not enqueued through the program.
+	 */
+	typedef bool (*CLHostCommand)(void* data);
+
 	/*!
 	 *	\class	CLProgram
 	 *	\brief	Compound of CLSubProgram and CLVariable objects ready to build and run on devices.
@@ -90,8 +95,20 @@ namespace isph {
 
 		/*!
 		 *	\brief	Get the program source in compiled form.
+		 *	\param	device	Index of linked device the binary is compiled for.
+		 */
+		std::string CompiledBinary(unsigned int device = 0);
+
+		/*!
+		 *	\brief	Set directory where compiled binaries are stored and reused by next builds. Empty disables caching.
+		 *	\remarks Binaries are keyed by hash of source, build options, device and driver version.
 		 */
-		std::string CompiledBinary();
+		void SetBinaryCache(const std::string& directory);
+
+		/*!
+		 *	\brief	Get directory of compiled binaries cache, empty if disabled.
+		 */
+		inline const std::string& BinaryCache() { return binaryCache; }
 
 		/*!
 		 *	\brief	Wait until program has finished.
@@ -134,6 +151,57 @@ namespace isph {
 		 */
 		bool ConnectSemantic(const std::string& semantic, CLVariable* var, bool autoUpdateKernelsIfNeeded = true);
 
+		/*!
+		 *	\brief	Swap data of two global buffers instead of copying, e.g. to ping-pong "old" and "current" values.
+		 *	\remarks Semantics stay connected to the same variables, only their device and host data is exchanged,
+		 *			so every semantic (and alias) of one buffer now represents the data of the other one.
+		 */
+		bool SwapBuffers(const std::string& semantic1, const std::string& semantic2);
+
+		/*!
+		 *	\brief	Swap data of two global buffers, already resolved from their semantics.
+		 */
+		bool SwapBuffers(CLGlobalBuffer* buffer1, CLGlobalBuffer* buffer2);
+
+		/*!
+		 *	\brief	Start recording enqueued subprograms, buffer copies and swaps, to replay them later.
+		 *	\remarks Previously recorded commands are cleared.
+		 */
+		void StartRecording();
+
+		/*!
+		 *	\brief	Stop recording commands.
+		 *	\return	If recorded commands can be replayed, i.e. host didn't read or write device data, reallocate buffers or change program constants while recording.
+		 */
+		bool StopRecording();
+
+		/*!
+		 *	\brief	Check if commands are being recorded.
+		 */
+		inline bool IsRecording() { return recording; }
+
+		/*!
+		 *	\brief	Mark recorded commands as not replayable, since host decisions depend on data of this run.
+		 *	\remarks Called when host reads or writes buffers, reallocates them, or changes program constants.
+		 */
+		inline void InvalidateRecording() { if(recording) recordReplayable = false; }
+
+		/*!
+		 *	\brief	Run host command now, and record it to run again on replay.
+		 *	\remarks Commands it enqueues are not recorded, since it enqueues them again on replay.
+		 */
+		bool RunHostCommand(CLHostCommand command, void* data);
+
+		/*!
+		 *	\brief	Enqueue recorded commands again, with values kernel arguments had when recorded.
+		 */
+		bool Replay();
+
+		/*!
+		 *	\brief	Check if there are recorded commands that can be replayed.
+		 */
+		inline bool CanReplay() { return !recording && recordReplayable && !record.empty(); }
+
 		/*!
 		 *	\brief	Get the amount of used memory in bytes program has allocated on devices.
 		 */
@@ -148,6 +216,36 @@ namespace isph {
 
 		friend class CLVariable;
 		friend class CLSubProgram;
+		friend class CLGlobalBuffer;
+
+		enum RecordedCommandType
+		{
+			RecordedKernel,
+			RecordedCopy,
+			RecordedSwap,
+			RecordedConnect,
+			RecordedHostCommand
+		};
+
+		struct RecordedCommand
+		{
+			RecordedCommandType type;
+			CLSubProgram* subprogram;
+			size_t globalSize, localSize;
+			CLGlobalBuffer *destination, *source;
+			std::string semantic;
+			CLVariable* variable;
+			bool autoUpdate;
+			CLHostCommand hostCommand;
+			void* hostData;
+			std::vector<std::pair<CLVariable*,std::string> > argumentValues;
+		};
+
+		RecordedCommand& Record(RecordedCommandType type);
+
+		std::string CachedBinaryPath(const std::string& buildOptions, unsigned int device);
+		bool LoadCachedBinaries(const std::string& buildOptions);
+		void StoreCachedBinaries(const std::string& buildOptions);
 
 		CLLink *link;
 
@@ -156,6 +254,7 @@ namespace isph {
 		std::string source;
 		bool isBuilt;
 		cl_program program;
+		std::string binaryCache;
 
 		std::list<CLVariable*> variablesList;
 		std::map<std::string,CLVariable*> variables;
@@ -165,6 +264,11 @@ namespace isph {
 		std::map<std::string,CLProgramConstant*> constants;
 
 		std::vector<CLSubProgram*> subprograms;
+
+		// recorded commands
+		std::vector<RecordedCommand> record;
+		bool recording;
+		bool recordReplayable;
 		
 	};
 
@@ -5,8 +5,11 @@ using namespace isph;
 
 CLSubProgram::CLSubProgram()
 	: isKernel(false)
+	, enabled(true)
 	, kernel(NULL)
 	, workGroupSizes(NULL)
+	, setLocalSize(0)
+	, parallelizeVariable(NULL)
 {
 }
 
@@ -117,6 +120,18 @@ void CLSubProgram::ReleaseKernel()
 		delete [] workGroupSizes;
 		workGroupSizes = NULL;
 	}
+
+	// new kernel object has no arguments set
+	setArguments.clear();
+	setArgumentChanges.clear();
+	setLocalSize = 0;
+}
+
+void CLSubProgram::SetEnabled(bool enable)
+{
+	enabled = enable;
+	if(!enabled)
+		ReleaseKernel();
 }
 
 bool CLSubProgram::Enqueue(size_t globalSize, size_t localSize)
@@ -135,6 +150,12 @@ bool CLSubProgram::Enqueue(size_t globalSize, size_t localSize)
 		return false;
 	}
 
+	if(!enabled)
+	{
+		Log::Send(Log::Error, "Cannot run kernel left out of program build: " + kernelName);
+		return false;
+	}
+
 	if(!program->IsBuilt())
 	{
 		Log::Send(Log::Error, "Cannot run subprogram (kernel) of incorrectly built program");
@@ -153,6 +174,25 @@ bool CLSubProgram::Enqueue(size_t globalSize, size_t localSize)
 		return false;
 	}
 
+	if(arguments.size() != semantics.size())
+	{
+		Log::Send(Log::Error, "Arguments of kernel aren't resolved: " + kernelName);
+		return false;
+	}
+
+	if(program->IsRecording())
+	{
+		CLProgram::RecordedCommand& command = program->Record(CLProgram::RecordedKernel);
+		command.subprogram = this;
+		command.globalSize = globalSize;
+		command.localSize = localSize;
+
+		// snapshot scalar arguments, so host may change them while recording
+		for(size_t j=0; j<arguments.size(); j++)
+			if(arguments[j]->Type() == KernelArgument && arguments[j]->data)
+				command.argumentValues.push_back(std::make_pair(arguments[j], std::string(arguments[j]->data, arguments[j]->MemorySize())));
+	}
+
 	cl_int status = 0;
 	cl_event* events = NULL;
 	if(CLSystem::Instance()->Profiling())
@@ -165,7 +205,7 @@ bool CLSubProgram::Enqueue(size_t globalSize, size_t localSize)
 		// enqueue for the device 
 		if(!globalSize)
 		{
-			var = program->Variable(parallelizeSemantic);
+			var = parallelizeVariable;
 			if(var)
 				globalSize = var->ElementCount(i);
 			else
@@ -180,22 +220,28 @@ bool CLSubProgram::Enqueue(size_t globalSize, size_t localSize)
 		}
 		while(globalSize % localSize != 0) localSize--; // globalSize has to be dividable with localSize
 
-		// pass arguments that opencl can't retain
-		for(unsigned int j=0; j<semantics.size(); j++)
+		// pass arguments that opencl can't retain, if changed since the last launch
+		for(unsigned int j=0; j<arguments.size(); j++)
 		{
-			var = program->Variable(semantics[j]);
-			if(var)
+			var = arguments[j];
+			if(var->Type() == GlobalBuffer)
+				continue;
+
+			if(setArguments[j] == var && setArgumentChanges[j] == var->dataChanges && (var->Type() != LocalBuffer || setLocalSize == localSize))
+				continue;
+
+			if(var->SetAsArgument(this, j, i, localSize))
 			{
-				if(var->Type() != GlobalBuffer)
-					if(!var->SetAsArgument(this, j, i, localSize))
-						Log::Send(Log::Error, "Error setting OpenCL kernel argument: " + semantics[j]);
+				setArguments[j] = var;
+				setArgumentChanges[j] = var->dataChanges;
 			}
 			else
 			{
-				Log::Send(Log::Error, "Program doesn't contain variable: " + semantics[j] + ", needed by kernel: " + kernelName);
-				return false;
+				setArguments[j] = NULL;
+				Log::Send(Log::Error, "Error setting OpenCL kernel argument: " + semantics[j]);
 			}
 		}
+		setLocalSize = localSize;
 
 		if(events)
 			status = clEnqueueNDRangeKernel(program->Link()->Queue(i), kernel, 1, NULL, &globalSize, &localSize, 0, NULL, &events[i]);
@@ -218,7 +264,7 @@ bool CLSubProgram::Enqueue(size_t globalSize, size_t localSize)
 			cl_ulong timeStart, timeEnd;
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &timeStart, NULL);
 			clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &timeEnd, NULL);
-			Log::Send(Log::DebugInfo, program->Link()->Device(i)->Name() + ": " + Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
+			LogMessage(Log::DebugInfo, program->Link()->Device(i)->Name() + ": " + Utils::IntegerString((int)(timeEnd-timeStart)/1000) + " microsecs");
 			clReleaseEvent(events[i]);
 		}
 		delete [] events;
@@ -295,25 +341,40 @@ bool CLSubProgram::SetPersistentArguments()
 	if(!kernel)
 		return false;
 
+	if(!ResolveArguments())
+		return false;
+
+	for(unsigned int j=0; j<arguments.size(); j++)
+	{
+		if(arguments[j]->Type() == GlobalBuffer)
+			if(!arguments[j]->SetAsArgument(this, j))
+			{
+				Log::Send(Log::Error, "Error setting OpenCL kernel argument: " + semantics[j]);
+				return false;
+			}
+	}
+
+	return true;
+}
+
+bool CLSubProgram::ResolveArguments()
+{
+	arguments.resize(semantics.size());
+	setArguments.resize(semantics.size(), NULL);
+	setArgumentChanges.resize(semantics.size(), 0);
+
 	for(unsigned int j=0; j<semantics.size(); j++)
 	{
-		CLVariable* var = program->Variable(semantics[j]);
-		if(var)
-		{
-			if(var->Type() == GlobalBuffer)
-				if(!var->SetAsArgument(this, j))
-				{
-					Log::Send(Log::Error, "Error setting OpenCL kernel argument: " + semantics[j]);
-					return false;
-				}
-		}
-		else
+		arguments[j] = program->Variable(semantics[j]);
+		if(!arguments[j])
 		{
 			Log::Send(Log::Error, "Program doesn't contain variable: " + semantics[j] + ", needed by kernel: " + kernelName);
+			arguments.clear();
 			return false;
 		}
 	}
 
+	parallelizeVariable = program->Variable(parallelizeSemantic);
 	return true;
 }
 
@@ -88,6 +88,17 @@ namespace isph {
 		 */
 		inline const std::string& ParallelizeSemantic() { return parallelizeSemantic; }
 
+		/*!
+		 *	\brief	Set if subprogram is built with the program. Disabled one is left out of program source, with its helper functions.
+		 *	\remarks Set it before program is built, for subprograms not reachable in chosen configuration.
+		 */
+		void SetEnabled(bool enable);
+
+		/*!
+		 *	\brief	Check if subprogram is built with the program.
+		 */
+		inline bool IsEnabled() { return enabled; }
+
 	private:
 
 		friend class CLProgram;
@@ -99,10 +110,12 @@ namespace isph {
 		void ReleaseKernel();
 
 		bool SetPersistentArguments();
+		bool ResolveArguments();
 
 		CLProgram* program;
 		std::string source;
 		bool isKernel;
+		bool enabled;
 		std::string kernelName;
 		std::vector<std::string> semantics;
 		std::string parallelizeSemantic;
@@ -110,6 +123,13 @@ namespace isph {
 		// kernel stuff
 		cl_kernel kernel; /// \todo make cl_kernel array for each device ?
 		size_t* workGroupSizes;
+
+		// variables resolved from semantics, and the state last passed to the kernel
+		std::vector<CLVariable*> arguments;
+		std::vector<CLVariable*> setArguments;
+		std::vector<unsigned int> setArgumentChanges;
+		size_t setLocalSize;
+		CLVariable* parallelizeVariable;
 	};
 
 }
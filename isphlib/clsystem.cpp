@@ -83,6 +83,9 @@ void CLSystem::Initialize()
 			clGetDeviceInfo(device->id, CL_DEVICE_VENDOR, sizeof(buf), buf, &size);
 			device->vendor = std::string(buf, size);
 
+			clGetDeviceInfo(device->id, CL_DRIVER_VERSION, sizeof(buf), buf, &size);
+			device->driverVersion = std::string(buf, size);
+
 			clGetDeviceInfo(device->id, CL_DEVICE_EXTENSIONS, sizeof(buf), buf, &size);
 			std::string extensions(buf, size);
 
@@ -94,6 +97,7 @@ void CLSystem::Initialize()
 			device->globalAtomics = 
 				(extensions.find("cl_khr_global_int32_base_atomics") != std::string::npos
 				&& extensions.find("cl_khr_global_int32_extended_atomics") != std::string::npos);
+			device->globalAtomics64 = (extensions.find("cl_khr_int64_base_atomics") != std::string::npos);
 			device->localAtomics = 
 				(extensions.find("cl_khr_local_int32_base_atomics") != std::string::npos
 				&& extensions.find("cl_khr_local_int32_extended_atomics") != std::string::npos);
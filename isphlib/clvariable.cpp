@@ -14,6 +14,7 @@ CLVariable::CLVariable(CLProgram* program, const std::string& semantic, Variable
 	, elementCount(0)
 	, memorySize(0)
 	, needsUpdate(false)
+	, dataChanges(0)
 {
 	if(program)
 	{
@@ -40,6 +41,11 @@ void CLVariable::SetSpace( VariableDataType dataType, unsigned int elements )
 	elementCount = elements;
 	varDataType = dataType;
 	memorySize = elements * DataTypeSize();
+	dataChanges++;
+
+	// recorded commands keep the old buffers and sizes
+	if(parentProgram)
+		parentProgram->InvalidateRecording();
 
 	if(Type() == KernelArgument || Type() == ProgramConstant)
 		Allocate();
@@ -113,6 +119,11 @@ bool CLVariable::SetScalar( unsigned int id, double var )
 		return false;
 	}
 
+	dataChanges++;
+
+	// constants are built into kernels, replay can't restore them like arguments
+	if(parentProgram && Type() == ProgramConstant)
+		parentProgram->InvalidateRecording();
 	return true;
 }
 
@@ -138,6 +149,11 @@ bool CLVariable::SetVector( unsigned int id, Vec<3,double> var )
 		return false;
 	}
 
+	dataChanges++;
+
+	// constants are built into kernels, replay can't restore them like arguments
+	if(parentProgram && Type() == ProgramConstant)
+		parentProgram->InvalidateRecording();
 	return true;
 }
 
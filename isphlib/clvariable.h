@@ -151,6 +151,7 @@ namespace isph
 		size_t elementCount;
 		size_t memorySize;
 		bool needsUpdate;
+		unsigned int dataChanges; // counts value changes, so kernels set only changed arguments
 		std::list<std::string> semantics;
 	};
 
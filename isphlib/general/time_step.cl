@@ -0,0 +1,41 @@
+R"(
+
+// indices of values in TIME_STEPS buffer, keep in sync with Simulation::TimeStepValue
+#define TIME_STEP_DT		0
+#define TIME_STEP_DT_INV	1
+#define TIME_STEP_HALF_DT	2
+#define TIME_STEP_DT_6		3
+#define TIME_STEP_TIME		4
+#define TIME_STEP_TIME_REST	5
+
+/*!
+ *	Simulation time is kept as a pair, so it doesn't drift when summed in single precision over many steps.
+ *	Steps are summed into the small rest, and whole multiples of TIME_QUANTUM (power of two) move from it to
+ *	TIME_STEP_TIME, which then sums them exactly up to 2^24 quanta.
+ */
+#define TIME_QUANTUM ((scalar)(1.0/1024))
+
+/*!
+ *	\brief	Simulation time at start of current time step
+ */
+inline scalar SimulationTime(__global const scalar *ts)
+{
+	return ts[TIME_STEP_TIME] + ts[TIME_STEP_TIME_REST];
+}
+
+/*!
+ *	\brief	Finish previous time step and start new one, values are read by integration kernels
+ */
+void StartTimeStep(__global scalar *ts, scalar dt)
+{
+	scalar rest = ts[TIME_STEP_TIME_REST] + ts[TIME_STEP_DT];
+	scalar whole = floor(rest / TIME_QUANTUM) * TIME_QUANTUM;
+	ts[TIME_STEP_TIME] += whole;
+	ts[TIME_STEP_TIME_REST] = rest - whole;
+	ts[TIME_STEP_DT] = dt;
+	ts[TIME_STEP_DT_INV] = (scalar)1 / dt;
+	ts[TIME_STEP_HALF_DT] = (scalar)0.5 * dt;
+	ts[TIME_STEP_DT_6] = dt / (scalar)6;
+}
+
+)" /* end OpenCL code */
@@ -15,6 +15,13 @@ typedef float4 scalar4;
 typedef float8 scalar8;
 #endif
 
+// PPE solver vectors, single precision when refining double precision solution
+#if FP == 64 && defined(MIXED_PRECISION)
+typedef float solver_scalar;
+#else
+typedef scalar solver_scalar;
+#endif
+
 #ifndef M_PI 
 #define M_PI 3.1415926535897932384626433832795
 #endif
@@ -231,8 +231,9 @@ std::string Geometry::GetMovementCode()
 	code << "(__global " << CLSystem::Instance()->DataTypeString(sim->VectorDataType()) << " *pos : POSITIONS";
 	code << ",__global const " << CLSystem::Instance()->DataTypeString(sim->VectorDataType()) << " *initPos : INITIAL_POSITIONS";
 	code << ",__global " << CLSystem::Instance()->DataTypeString(sim->VectorDataType()) << " *vel : VELOCITIES";
-	code << ", " << CLSystem::Instance()->DataTypeString(sim->ScalarDataType()) << " dt : TIME_STEP";
-	code << ", " << CLSystem::Instance()->DataTypeString(sim->ScalarDataType()) << " t : TIME) {" << std::endl;
+	code << ",__global const " << CLSystem::Instance()->DataTypeString(sim->ScalarDataType()) << " *timeSteps : TIME_STEPS) {" << std::endl;
+	code << "scalar dt = timeSteps[TIME_STEP_DT];" << std::endl;
+	code << "scalar t = SimulationTime(timeSteps);" << std::endl;
 	code << "__local vector calcExp[2];" << std::endl;
 	code << "uint i = get_global_id(0);" << std::endl;
 	code << "if(get_local_id(0) == 0) {" << std::endl;
@@ -10,9 +10,10 @@ __kernel void IntegratePredictor
 	__global const vector *acc : ACCELERATIONS,
 	__global const scalar *densityRoC : DENSITY_ROC,
 	uint fpc : FLUID_PARTICLE_COUNT,
-	scalar half_dt : HALF_TIME_STEP
+	__global const scalar *timeSteps : TIME_STEPS
 )
 {
+	scalar half_dt = timeSteps[TIME_STEP_HALF_DT];
 	size_t i = get_global_id(0);
 	density[i] += densityRoC[i] * half_dt;
 	
@@ -17,9 +17,10 @@ __kernel void IntegrateRK41
 	__global scalar *densityRoCRK : DENSITY_ROC_RK,
 	uint fpc : FLUID_PARTICLE_COUNT,
 	uint pc : PARTICLE_COUNT,
-	scalar dt : HALF_TIME_STEP
+	__global const scalar *timeSteps : TIME_STEPS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_HALF_DT];
 	size_t i = get_global_id(0);
 	if(i >= pc)
 		return;
@@ -17,9 +17,10 @@ __kernel void IntegrateRK44
 	__global scalar *densityRoCRK : DENSITY_ROC_RK,
 	uint fpc : FLUID_PARTICLE_COUNT,
 	uint pc : PARTICLE_COUNT,
-	scalar dt : TIME_STEP_6
+	__global const scalar *timeSteps : TIME_STEPS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_DT_6];
 	size_t i = get_global_id(0);
 	if(i >= pc)
 		return;
@@ -0,0 +1,86 @@
+R"(
+
+/*!
+ *	\brief	Assemble PPE matrix coefficients in ELLPACK format, same as implicit matrix-vector product uses
+ *
+ *	Rows wider than PPE_ROW_WIDTH don't fit, and the greatest such length is kept in PPE_ROW_OVERFLOW for host.
+ */
+__kernel void AssembleMatrix
+(
+	__global uint *cols				: PPE_COLUMNS,
+	__global solver_scalar *values	: PPE_VALUES,
+	__global solver_scalar *diag	: PPE_DIAGONAL,
+	__global uint *rowLengths		: PPE_ROW_LENGTHS,
+	__global const scalar *vol		: VOLUMES,
+	__global const scalar *sortedVol : SORTED_VOLUMES,
+	__global const char *typ		: CLASS,
+	__global const char *free_surface : FREE_SURFACE,
+	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes 	: HASHES,
+	__global uint *rowOverflow		: PPE_ROW_OVERFLOW,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	char type = typ[i];
+
+	if(!IsParticleWall(type) && !IsParticleFluid(type)
+#ifdef STRONG_DIRICHLET
+	|| free_surface[i]
+#endif
+	)
+	{
+		diag[i] = (solver_scalar)0;
+		rowLengths[i] = 0;
+		return;
+	}
+
+	vector posI = pos[i];
+	scalar volInvI = 1.0/vol[i];
+	scalar dI = (scalar)0;
+	uint k = 0;
+#ifdef CORRECT_KERNEL
+	sym_tensor corrTensor = kernelCorr[i];
+#endif
+
+	ForEachSetup(posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
+		if(IsParticleWall(type) && IsParticleDummy(typ[j]))
+			continue;
+
+		vector gradW = SphKernelGrad(QSq, posDif);
+#ifdef CORRECT_KERNEL
+		gradW = CorrectGradW(gradW, corrTensor);
+#endif
+		scalar aIJ = volInvI + 1.0/sortedVol[SORTED_J];
+		aIJ = dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
+		dI += aIJ;
+
+		if(k < PPE_ROW_WIDTH)
+		{
+			cols[k*PPE_STRIDE + i] = SORTED_J;
+			values[k*PPE_STRIDE + i] = (solver_scalar)(-8 / MASS * aIJ);
+		}
+		k++;
+	ForEachEnd
+
+	if(k > PPE_ROW_WIDTH)
+		atomic_max(rowOverflow, k);
+
+	if(IsParticleFluid(type) && free_surface[i])
+		dI *= 2;
+
+	diag[i] = (solver_scalar)(8 / MASS * dI);
+	rowLengths[i] = min(k, (uint)PPE_ROW_WIDTH);
+}
+
+)" /* end OpenCL code */
@@ -5,12 +5,12 @@ R"(
  */
 __kernel void UpdateConjugate_0
 (
-	__global scalar *conjugate : CONJUGATE_0,
-	__global const scalar *residual : RESIDUAL,
-	__global const scalar *tmp0 : TMP_0,
+	__global solver_scalar *conjugate : CONJUGATE_0,
+	__global const solver_scalar *residual : RESIDUAL,
+	__global const solver_scalar *tmp0 : TMP_0,
 	uint pc : PARTICLE_COUNT,
-	scalar beta : CG_BETA,
-	scalar omega : CG_OMEGA
+	solver_scalar beta : CG_BETA,
+	solver_scalar omega : CG_OMEGA
 )
 {
 	size_t i = get_global_id(0);
@@ -0,0 +1,22 @@
+R"(
+
+/*!
+ *	\brief	Update BiCGSTAB first conjugate vector, with beta and omega read from device
+ */
+__kernel void UpdateConjugate_0_Device
+(
+	__global solver_scalar *conjugate : CONJUGATE_0,
+	__global const solver_scalar *residual : RESIDUAL,
+	__global const solver_scalar *tmp0 : TMP_0,
+	__global const solver_scalar *s : KRYLOV_SCALARS,
+	uint pc : PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i < pc && s[KRYLOV_DONE] == (solver_scalar)0)
+	{
+		conjugate[i] = residual[i] + s[KRYLOV_BETA] * (conjugate[i] - s[KRYLOV_OMEGA] * tmp0[i]);
+	}
+}
+
+)" /* end OpenCL code */
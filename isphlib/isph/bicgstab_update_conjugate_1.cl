@@ -5,11 +5,11 @@ R"(
  */
 __kernel void UpdateConjugate_1
 (
-	__global scalar *conjugate : CONJUGATE_1,
-	__global const scalar *residual : RESIDUAL,
-	__global const scalar *tmp0 : TMP_0,
+	__global solver_scalar *conjugate : CONJUGATE_1,
+	__global const solver_scalar *residual : RESIDUAL,
+	__global const solver_scalar *tmp0 : TMP_0,
 	uint pc : PARTICLE_COUNT,
-	scalar alpha : CG_ALPHA
+	solver_scalar alpha : CG_ALPHA
 )
 {
 	size_t i = get_global_id(0);
@@ -0,0 +1,22 @@
+R"(
+
+/*!
+ *	\brief	Update BiCGSTAB 2nd conjugate vector, with alpha read from device
+ */
+__kernel void UpdateConjugate_1_Device
+(
+	__global solver_scalar *conjugate : CONJUGATE_1,
+	__global const solver_scalar *residual : RESIDUAL,
+	__global const solver_scalar *tmp0 : TMP_0,
+	__global const solver_scalar *s : KRYLOV_SCALARS,
+	uint pc : PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i < pc && s[KRYLOV_DONE] == (solver_scalar)0)
+	{
+		conjugate[i] = residual[i] - s[KRYLOV_ALPHA] * tmp0[i];
+	}
+}
+
+)" /* end OpenCL code */
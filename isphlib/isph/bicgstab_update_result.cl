@@ -5,20 +5,21 @@ R"(
  */
 __kernel void UpdateResultAndResidual
 (
-	__global scalar *residual : RESIDUAL,
-	__global scalar *result : PRESSURES,
-	__global const scalar *p : CONJUGATE_0,
-	__global const scalar *s : CONJUGATE_1,
-	__global const scalar *tmp1 : TMP_1,
+	__global solver_scalar *residual : RESIDUAL,
+	__global solver_scalar *result : SOLUTION,
+	__global const solver_scalar *pHat : PRECONDITIONED_0,
+	__global const solver_scalar *sHat : PRECONDITIONED_1,
+	__global const solver_scalar *s : CONJUGATE_1,
+	__global const solver_scalar *tmp1 : TMP_1,
 	uint pc : PARTICLE_COUNT,
-	scalar alpha : CG_ALPHA,
-	scalar omega : CG_OMEGA
+	solver_scalar alpha : CG_ALPHA,
+	solver_scalar omega : CG_OMEGA
 )
 {
 	size_t i = get_global_id(0);
 	if(i < pc)
 	{
-		result[i] += alpha * p[i] + omega * s[i];
+		result[i] += alpha * pHat[i] + omega * sHat[i];
 		residual[i] = s[i] - omega * tmp1[i];
 	}
 }
@@ -0,0 +1,26 @@
+R"(
+
+/*!
+ *	\brief	Update BiCGSTAB result and resiudal vector, with alpha and omega read from device
+ */
+__kernel void UpdateResultAndResidualDevice
+(
+	__global solver_scalar *residual : RESIDUAL,
+	__global solver_scalar *result : SOLUTION,
+	__global const solver_scalar *pHat : PRECONDITIONED_0,
+	__global const solver_scalar *sHat : PRECONDITIONED_1,
+	__global const solver_scalar *s : CONJUGATE_1,
+	__global const solver_scalar *tmp1 : TMP_1,
+	__global const solver_scalar *k : KRYLOV_SCALARS,
+	uint pc : PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i < pc && k[KRYLOV_DONE] == (solver_scalar)0)
+	{
+		result[i] += k[KRYLOV_ALPHA] * pHat[i] + k[KRYLOV_OMEGA] * sHat[i];
+		residual[i] = s[i] - k[KRYLOV_OMEGA] * tmp1[i];
+	}
+}
+
+)" /* end OpenCL code */
@@ -7,21 +7,38 @@ __kernel void BuildRHS
 (
 	__global scalar *rhs			: RHS,
 	__global const scalar *vol		: VOLUMES,
+	__global const scalar *sortedVol : SORTED_VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const char *free_surface : FREE_SURFACE,
 	__global const vector *vel		: VELOCITIES,
+	__global const vector *sortedVel : SORTED_VELOCITIES,
 	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
 	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
 	__global scalar * p				: PRESSURES,
-	__global const uint *cellsStart : CELLS_START,
+	__global solver_scalar *diag	: PPE_DIAGONAL,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT,
-	scalar dt_inv					: TIME_STEP_INV
+	__global const scalar *timeSteps	: TIME_STEPS
 )
 {
+	scalar dt_inv = timeSteps[TIME_STEP_DT_INV];
 	size_t i = get_global_id(0);
 	
+#ifdef WARM_START
+	// previous pressure is kept as initial guess, except where pressure is fixed to zero
+	if(i >= particleCount
+#ifdef STRONG_DIRICHLET
+	|| free_surface[i]
+#endif
+	)
+		p[i] = (scalar)0;
+#else
 	p[i] = (scalar)0;
+#endif
 	
 	if(i >= particleCount)
 	{
@@ -29,16 +46,34 @@ __kernel void BuildRHS
 		return;
 	}
 
-	if(!IsParticleFluid(typ[i])
+	char type = typ[i];
+	bool rhsRow = IsParticleFluid(type)
+#ifdef STRONG_DIRICHLET
+	&& !free_surface[i]
+#endif
+	;
+
+#ifdef RHS_DIAGONAL
+	// PPE matrix diagonal for Jacobi preconditioner, same rows as implicit matrix-vector product
+	if(!rhsRow && (!IsParticleWall(type)
 #ifdef STRONG_DIRICHLET
 	|| free_surface[i]
 #endif
-	)
+	))
 	{
 		rhs[i] = (scalar)0;
+		diag[i] = (solver_scalar)0;
 		return;
 	}
-	
+	scalar volInvI = 1.0/vol[i];
+	scalar dI = (scalar)0;
+#else
+	if(!rhsRow)
+	{
+		rhs[i] = (scalar)0;
+		return;
+	}
+#endif
 	
 	vector posI = pos[i];
 	vector velI = vel[i];
@@ -48,21 +83,38 @@ __kernel void BuildRHS
 #endif
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 	
 		/*if(IsParticleWall(typ[i]) && !IsParticleFluid(typ[j]))
 			continue;*/
 	
-		vector velDif = vel[j] - velI;
 		vector gradW = SphKernelGrad(QSq, posDif);
 #ifdef CORRECT_KERNEL
 		gradW = CorrectGradW(gradW, corrTensor);
 #endif
-		bI += dot(gradW, velDif) * vol[j];
+		if(rhsRow)
+		{
+			vector velDif = sortedVel[SORTED_J] - velI;
+			bI += dot(gradW, velDif) * sortedVol[SORTED_J];
+		}
+
+#ifdef RHS_DIAGONAL
+		if(!IsParticleWall(type) || !IsParticleDummy(typ[j]))
+		{
+			scalar aIJ = volInvI + 1.0/sortedVol[SORTED_J];
+			dI += dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
+		}
+#endif
 
 	ForEachEnd
 	
 	rhs[i] = bI * dt_inv;
+
+#ifdef RHS_DIAGONAL
+	if(IsParticleFluid(type) && free_surface[i])
+		dI *= 2;
+	diag[i] = (solver_scalar)(8 / MASS * dI);
+#endif
 }
 
 )" /* end OpenCL code */
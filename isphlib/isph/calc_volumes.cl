@@ -4,7 +4,10 @@ __kernel void CalcVolumes
 	__global scalar *vol			: VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const vector *pos 		: POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT
 )
@@ -25,7 +28,7 @@ __kernel void CalcVolumes
 	scalar v = (scalar)0;
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 		v += SphKernel(QSq);
 	ForEachEnd
 	
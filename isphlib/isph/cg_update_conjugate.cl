@@ -6,10 +6,10 @@ R"(
 __kernel void UpdateConjugate
 (
 	__global const char *typ : CLASS,
-	__global scalar *conjugate : CONJUGATE,
-	__global const scalar *residual : RESIDUAL,
+	__global solver_scalar *conjugate : CONJUGATE,
+	__global const solver_scalar *residual : PRECONDITIONED,
 	uint pc : PARTICLE_COUNT,
-	scalar beta : CG_BETA
+	solver_scalar beta : CG_BETA
 )
 {
 	size_t i = get_global_id(0);
@@ -17,7 +17,7 @@ __kernel void UpdateConjugate
 		return;
 	if(IsParticleDummy(typ[i]))
 	{
-		conjugate[i] = (scalar)0;
+		conjugate[i] = (solver_scalar)0;
 	}
 	{
 		conjugate[i] = residual[i] + beta * conjugate[i];
@@ -0,0 +1,32 @@
+R"(
+
+/*!
+ *	\brief	Update CG conjugate vector, with beta read from device
+ */
+__kernel void UpdateConjugateDevice
+(
+	__global const char *typ : CLASS,
+	__global solver_scalar *conjugate : CONJUGATE,
+	__global const solver_scalar *residual : PRECONDITIONED,
+	__global const solver_scalar *s : KRYLOV_SCALARS,
+	uint pc : PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i >= pc)
+		return;
+	if(s[KRYLOV_DONE] != (solver_scalar)0)
+		return;
+
+	solver_scalar beta = s[KRYLOV_BETA];
+
+	if(IsParticleDummy(typ[i]))
+	{
+		conjugate[i] = (solver_scalar)0;
+	}
+	{
+		conjugate[i] = residual[i] + beta * conjugate[i];
+	}
+}
+
+)" /* end OpenCL code */
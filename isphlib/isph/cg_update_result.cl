@@ -6,12 +6,12 @@ R"(
 __kernel void UpdateResultAndResidual
 (
 	__global const char *typ : CLASS,
-	__global scalar *residual : RESIDUAL,
-	__global scalar *result : PRESSURES,
-	__global const scalar *conjugate : CONJUGATE,
-	__global const scalar *tmp : TMP,
+	__global solver_scalar *residual : RESIDUAL,
+	__global solver_scalar *result : SOLUTION,
+	__global const solver_scalar *conjugate : CONJUGATE,
+	__global const solver_scalar *tmp : TMP,
 	uint pc : PARTICLE_COUNT,
-	scalar alpha : CG_ALPHA
+	solver_scalar alpha : CG_ALPHA
 )
 {
 	size_t i = get_global_id(0);
@@ -20,7 +20,7 @@ __kernel void UpdateResultAndResidual
 	
 	if(IsParticleDummy(typ[i]))
 	{
-		result[i] = residual[i] = (scalar)0;
+		result[i] = residual[i] = (solver_scalar)0;
 	}
 	{
 		result[i] += alpha * conjugate[i];
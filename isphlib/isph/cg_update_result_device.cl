@@ -0,0 +1,35 @@
+R"(
+
+/*!
+ *	\brief	Update CG result and resiudal vector, with alpha read from device
+ */
+__kernel void UpdateResultAndResidualDevice
+(
+	__global const char *typ : CLASS,
+	__global solver_scalar *residual : RESIDUAL,
+	__global solver_scalar *result : SOLUTION,
+	__global const solver_scalar *conjugate : CONJUGATE,
+	__global const solver_scalar *tmp : TMP,
+	__global const solver_scalar *s : KRYLOV_SCALARS,
+	uint pc : PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i >= pc)
+		return;
+	if(s[KRYLOV_DONE] != (solver_scalar)0)
+		return;
+
+	solver_scalar alpha = s[KRYLOV_ALPHA];
+
+	if(IsParticleDummy(typ[i]))
+	{
+		result[i] = residual[i] = (solver_scalar)0;
+	}
+	{
+		result[i] += alpha * conjugate[i];
+		residual[i] -= alpha * tmp[i];
+	}
+}
+
+)" /* end OpenCL code */
@@ -5,30 +5,44 @@ R"(
  */
 __kernel void CorrectorStep
 (
-	__global vector *pos			: POSITIONS,
+	__global const vector *pos		: POSITIONS,
+	__global vector *newPos			: POSITIONS_TEMP,
 	__global vector *vel			: VELOCITIES,
 	__global const scalar *vol		: VOLUMES,
+	__global const scalar *sortedVol : SORTED_VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const scalar *press	: PRESSURES,
+	__global const scalar *sortedPress : SORTED_PRESSURES,
 	__global const char *free_surface : FREE_SURFACE,
 	__global const vector *old_pos	: POSITIONS_OLD,
 	__global const vector *old_vel	: VELOCITIES_OLD,
-	__global const vector *temp_pos : POSITIONS_TEMP,
+	__global const vector *sortedPos : SORTED_POSITIONS,
 	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT,
-	scalar dt						: TIME_STEP
+	__global const scalar *timeSteps	: TIME_STEPS,
+	__global vector *summedGradP	: PRESSURE_GRADIENTS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_DT];
 	size_t i = get_global_id(0);
-	if(i >= particleCount)
-		return;
+	vector posI = pos[i];
 
-	if(!IsParticleFluid(typ[i]))
+	// new positions are written out of place and swapped with current ones afterwards
+	if(i >= particleCount || !IsParticleFluid(typ[i]))
+	{
+		newPos[i] = posI;
 		return;
+	}
 	
-	vector posI = temp_pos[i];
+#ifdef SUMMED_PRESSURE_GRADIENT
+	// summed by pair-wise or tiled kernel, cleared for the next time step
+	vector gradP = summedGradP[i];
+	summedGradP[i] = (vector)0;
+#else
 	vector gradP = (vector)0;
 	scalar podI = press[i] * pown(vol[i],2);
 #ifdef CORRECT_KERNEL
@@ -36,7 +50,7 @@ __kernel void CorrectorStep
 #endif
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,temp_pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 
 		vector gradW = SphKernelGrad(QSq, posDif);
 #ifdef CORRECT_KERNEL
@@ -45,18 +59,19 @@ __kernel void CorrectorStep
 
 #ifdef STRONG_DIRICHLET
 	if(free_surface[i])
-		gradP += (1.25*press[j]*pown(vol[j],2)) * gradW;
+		gradP += (1.25*sortedPress[SORTED_J]*pown(sortedVol[SORTED_J],2)) * gradW;
 	else if(free_surface[j])
 		gradP += (2*podI) * gradW;
 	else
 #endif
-		gradP += (press[j]*pown(vol[j],2) + podI) * gradW;
+		gradP += (sortedPress[SORTED_J]*pown(sortedVol[SORTED_J],2) + podI) * gradW;
 		
 	ForEachEnd
+#endif
 	
 	vector v = vel[i] - gradP * (dt / MASS);
 	vel[i] = v;
-	pos[i] = old_pos[i] + 0.5 * dt * (old_vel[i] + v);
+	newPos[i] = old_pos[i] + 0.5 * dt * (old_vel[i] + v);
 }
 
 )" /* end OpenCL code */
@@ -9,7 +9,8 @@ __kernel void DivVel
 	__global const vector *vel		: VELOCITIES,
 	__global const char *typ		: CLASS,
 	__global const vector *pos 		: POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT
 )
@@ -28,7 +29,7 @@ __kernel void DivVel
 	scalar divVel = (scalar)0;
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,sortedPos,posI)
 	
 		/*if(!IsParticleFluid(typ[j]))
 			continue;*/
@@ -3,10 +3,10 @@ R"(
 __kernel void VectorDotProduct
 (
 	__global const char *typ	: CLASS,
-	__global const scalar *in1	: DOT_1,
-	__global const scalar *in2	: DOT_2,
-	__global scalar *g_odata	: DOT_OUT,
-	__local scalar *sdata		: LOCAL_DOT,
+	__global const solver_scalar *in1	: DOT_1,
+	__global const solver_scalar *in2	: DOT_2,
+	__global solver_scalar *g_odata	: DOT_OUT,
+	__local solver_scalar *sdata		: LOCAL_DOT,
 	uint n						: PARTICLE_COUNT
 )
 {
@@ -18,7 +18,7 @@ __kernel void VectorDotProduct
 	size_t start      = min((size_t)n, chunk_size * get_global_id(0));
 	size_t stop       = min((size_t)n, start + chunk_size);
 	
-	scalar mySum      = (scalar)0;
+	solver_scalar mySum      = (solver_scalar)0;
 	for (size_t i = start; i < stop; i++)
 		if(!IsParticleDummy(typ[i])) mySum += in1[i] * in2[i];
 	
@@ -32,7 +32,7 @@ __kernel void VectorDotProduct
 	size_t gridSize   = get_num_groups(0) * block_size * 2;
 
 	size_t i;
-	scalar mySum      = (scalar)0;
+	solver_scalar mySum      = (solver_scalar)0;
 	while (p < n)
 	{
 		i = p;
@@ -0,0 +1,79 @@
+R"(
+
+/*!
+ *	\brief	Two dot products in one reduction: in1.in1 and in2.in1
+ *
+ *	Partial results of the first product are in the first half of output, and of the second in the other half.
+ */
+__kernel void VectorDotProductPair
+(
+	__global const char *typ	: CLASS,
+	__global const solver_scalar *in1	: DOT_1,
+	__global const solver_scalar *in2	: DOT_2,
+	__global solver_scalar *g_odata	: DOT_PAIR_OUT,
+	__local solver_scalar *sdata		: LOCAL_DOT_PAIR,
+	uint n						: PARTICLE_COUNT
+)
+{
+	size_t groups = get_num_groups(0);
+
+#ifdef CPU
+
+	size_t grid_size  = get_global_size(0);
+	size_t chunk_size = (n + grid_size - 1) / grid_size;
+	size_t start      = min((size_t)n, chunk_size * get_global_id(0));
+	size_t stop       = min((size_t)n, start + chunk_size);
+	
+	solver_scalar sum1       = (solver_scalar)0;
+	solver_scalar sum2       = (solver_scalar)0;
+	for (size_t i = start; i < stop; i++)
+	{
+		if(!IsParticleDummy(typ[i]))
+		{
+			sum1 += in1[i] * in1[i];
+			sum2 += in2[i] * in1[i];
+		}
+	}
+	
+	g_odata[get_group_id(0)] = sum1;
+	g_odata[groups + get_group_id(0)] = sum2;
+
+#else
+
+	size_t tid        = get_local_id(0);
+	size_t block_size = get_local_size(0);
+	__local solver_scalar *sdata2 = sdata + block_size;
+
+	solver_scalar sum1       = (solver_scalar)0;
+	solver_scalar sum2       = (solver_scalar)0;
+	for (size_t i = get_global_id(0); i < n; i += get_global_size(0))
+	{
+		if(!IsParticleDummy(typ[i]))
+		{
+			sum1 += in1[i] * in1[i];
+			sum2 += in2[i] * in1[i];
+		}
+	}
+	sdata[tid] = sum1;
+	sdata2[tid] = sum2;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for (size_t s = block_size / 2; s > 0; s >>= 1)
+	{
+		if (tid < s)
+		{
+			sdata[tid] += sdata[tid + s];
+			sdata2[tid] += sdata2[tid + s];
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (tid == 0)
+	{
+		g_odata[get_group_id(0)] = sdata[0];
+		g_odata[groups + get_group_id(0)] = sdata2[0];
+	}
+#endif
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,30 @@
+R"(
+
+/*!
+ *	\brief	Copy solver precision values of wall particles to its dummies
+ */
+__kernel void DummySolverScalarCopy
+(
+	__global solver_scalar *vec	: DUMMY_SOLVER_SCALAR,
+	__global const char *typ	: CLASS,
+	uint particleCount			: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	char type = typ[i];
+
+	if(!IsParticleWall(type))
+		return;
+	
+	solver_scalar vecI = vec[i];
+
+	size_t j = i+1;
+	while(j < particleCount && IsParticleDummy(typ[j]))
+		vec[j++] = vecI;
+}
+
+)" /* end OpenCL code */
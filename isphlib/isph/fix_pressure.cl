@@ -6,7 +6,8 @@ __kernel void FixPressure
 	__global const char *typ		: CLASS,
 	__global const char *free_surface : FREE_SURFACE,
 	__global const vector *pos 		: POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT
 )
@@ -23,7 +24,7 @@ __kernel void FixPressure
 	scalar pAdd = (scalar)0;
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,sortedPos,posI)
 		
 	if(IsParticleWall(typ[j]) && dot(posDif,posDif) < 1.35*PARTICLE_SPACING)
 	{
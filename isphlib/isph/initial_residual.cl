@@ -0,0 +1,22 @@
+R"(
+
+/*!
+ *	\brief	Residual of initial pressure guess: r = b - A.x0
+ */
+__kernel void InitialResidual
+(
+	__global solver_scalar *residual		: RESIDUAL,
+	__global const solver_scalar *rhs		: SOLVER_RHS,
+	__global const solver_scalar *product	: INITIAL_PRODUCT,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	residual[i] = rhs[i] - product[i];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,23 @@
+R"(
+
+/*!
+ *	\brief	Apply diagonal (Jacobi) preconditioner to a vector
+ */
+__kernel void ApplyJacobiPreconditioner
+(
+	__global solver_scalar *out		: PRECONDITIONER_OUT,
+	__global const solver_scalar *in	: PRECONDITIONER_IN,
+	__global const solver_scalar *diag	: PPE_DIAGONAL,
+	uint particleCount			: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	solver_scalar dI = diag[i];
+	out[i] = dI != (solver_scalar)0 ? in[i] / dI : in[i];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,97 @@
+R"(
+
+// indices of solver scalars in KRYLOV_SCALARS buffer, keep in sync with IsphSimulation::KrylovScalar
+#define KRYLOV_RR			0
+#define KRYLOV_RR_0			1
+#define KRYLOV_RESIDUAL		2
+#define KRYLOV_ALPHA		3
+#define KRYLOV_BETA			4
+#define KRYLOV_OMEGA		5
+#define KRYLOV_TEMP			6
+#define KRYLOV_DONE			7
+
+// operations done with finished dot product, keep in sync with IsphSimulation::KrylovOperation
+#define KRYLOV_OP_INIT			0
+#define KRYLOV_OP_STORE			1
+#define KRYLOV_OP_ALPHA			2
+#define KRYLOV_OP_OMEGA			3
+#define KRYLOV_OP_RESIDUAL		4
+#define KRYLOV_OP_CG_BETA		5
+#define KRYLOV_OP_BICGSTAB_BETA	6
+#define KRYLOV_OP_PRECOND_BETA	7
+#define KRYLOV_OP_REFERENCE		8
+
+/*!
+ *	\brief	Sum partial dot product results and update solver scalars on device
+ */
+__kernel void FinishDotProduct
+(
+	__global solver_scalar *s			: KRYLOV_SCALARS,
+	__global const solver_scalar *part	: DOT_OUT,
+	uint op						: KRYLOV_OP
+)
+{
+	if(get_global_id(0) > 0)
+		return;
+
+	solver_scalar sum = (solver_scalar)0;
+	for(uint i=0; i<DOT_PARTIALS; i++)
+		sum += part[i];
+
+	if(op == KRYLOV_OP_INIT)
+	{
+		s[KRYLOV_RR] = s[KRYLOV_RR_0] = s[KRYLOV_RESIDUAL] = sum;
+		s[KRYLOV_ALPHA] = s[KRYLOV_BETA] = s[KRYLOV_OMEGA] = s[KRYLOV_TEMP] = (solver_scalar)0;
+		s[KRYLOV_DONE] = (solver_scalar)0;
+		return;
+	}
+
+	// reference norm for convergence, when initial guess isn't zero and residual differs from RHS
+	if(op == KRYLOV_OP_REFERENCE)
+	{
+		s[KRYLOV_RR_0] = sum;
+		if(fabs(s[KRYLOV_RESIDUAL]) <= PPE_TOLERANCE_SQ * fabs(sum))
+			s[KRYLOV_DONE] = (solver_scalar)1;
+		return;
+	}
+
+	// once converged, keep the scalars so the remaining iterations until host polls change nothing
+	if(s[KRYLOV_DONE] != (solver_scalar)0)
+		return;
+
+	switch(op)
+	{
+	case KRYLOV_OP_STORE:
+		s[KRYLOV_TEMP] = sum;
+		break;
+	case KRYLOV_OP_ALPHA:
+		s[KRYLOV_ALPHA] = s[KRYLOV_RR] / sum;
+		break;
+	case KRYLOV_OP_OMEGA:
+		s[KRYLOV_OMEGA] = s[KRYLOV_TEMP] / sum;
+		break;
+	case KRYLOV_OP_RESIDUAL:
+	case KRYLOV_OP_CG_BETA:
+		s[KRYLOV_RESIDUAL] = sum;
+		if(fabs(sum) <= PPE_TOLERANCE_SQ * fabs(s[KRYLOV_RR_0]))
+		{
+			s[KRYLOV_DONE] = (solver_scalar)1;
+		}
+		else if(op == KRYLOV_OP_CG_BETA)
+		{
+			s[KRYLOV_BETA] = sum / s[KRYLOV_RR];
+			s[KRYLOV_RR] = sum;
+		}
+		break;
+	case KRYLOV_OP_PRECOND_BETA:
+		s[KRYLOV_BETA] = sum / s[KRYLOV_RR];
+		s[KRYLOV_RR] = sum;
+		break;
+	case KRYLOV_OP_BICGSTAB_BETA:
+		s[KRYLOV_BETA] = (sum / s[KRYLOV_RR]) * (s[KRYLOV_ALPHA] / s[KRYLOV_OMEGA]);
+		s[KRYLOV_RR] = sum;
+		break;
+	}
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,56 @@
+R"(
+
+/*!
+ *	\brief	Galerkin coarse matrix on grid cells, summing assembled PPE matrix over particles in cells
+ */
+__kernel void MultigridAssembleCells
+(
+	__global solver_scalar *mat			: MG_MATRIX,
+	__global const uint *cols		: PPE_COLUMNS,
+	__global const solver_scalar *values	: PPE_VALUES,
+	__global const solver_scalar *diag		: PPE_DIAGONAL,
+	__global const uint *rowLengths	: PPE_ROW_LENGTHS,
+	__global const uint *particleCells : MG_PARTICLE_CELLS,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes 	: HASHES,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 level = MG_LEVELS[0];
+	uint cellCount = MgCells(level);
+
+	if(cell >= cellCount)
+		return;
+
+	solver_scalar a[MG_STENCIL];
+	for(uint s=0; s<MG_STENCIL; s++)
+		a[s] = (solver_scalar)0;
+
+	int4 cellI = MgCellCoords(cell, level);
+
+	uint2 range = CellRange(cellRanges, hashes, MgGridHash(cell, level));
+	for(uint k=range.x; k<range.y; k++)
+	{
+		uint i = hashes[k].y;
+		a[MG_CENTER] += diag[i];
+
+		uint rowLength = rowLengths[i];
+		for(uint e=0; e<rowLength; e++)
+		{
+			uint col = cols[e*PPE_STRIDE + i];
+#ifdef REORDER_PARTICLES
+			col = hashes[col].y;
+#endif
+			int4 d = MgCellCoords(particleCells[col], level) - cellI;
+			if(abs(d.x) <= 1 && abs(d.y) <= 1 && abs(d.z) <= 1)
+				a[MgStencilIndex(d)] += values[e*PPE_STRIDE + i];
+		}
+	}
+
+	__global solver_scalar *out = mat + level.w * MG_STENCIL + cell;
+	for(uint s=0; s<MG_STENCIL; s++)
+		out[s*cellCount] = a[s];
+}
+
+)" /* end OpenCL code */
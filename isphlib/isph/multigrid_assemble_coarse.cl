@@ -0,0 +1,50 @@
+R"(
+
+/*!
+ *	\brief	Galerkin coarse matrix of a multigrid level, aggregating stencils of the finer level
+ */
+__kernel void MultigridAssembleCoarse
+(
+	__global solver_scalar *mat	: MG_MATRIX,
+	uint lvl				: MG_LEVEL
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 coarse = MG_LEVELS[lvl];
+	uint4 fine = MG_LEVELS[lvl-1];
+	uint coarseCount = MgCells(coarse);
+	uint fineCount = MgCells(fine);
+
+	if(cell >= coarseCount)
+		return;
+
+	solver_scalar a[MG_STENCIL];
+	for(uint s=0; s<MG_STENCIL; s++)
+		a[s] = (solver_scalar)0;
+
+	int4 cellI = MgCellCoords(cell, coarse);
+	__global const solver_scalar *fineMat = mat + fine.w * MG_STENCIL;
+
+	for(uint c=0; c<MG_CHILDREN; c++)
+	{
+		int4 child = 2*cellI + (int4)(c & 1, (c >> 1) & 1, (c >> 2) & 1, 0);
+		if(!MgInside(child, fine))
+			continue;
+		uint f = MgCellIndex(child, fine);
+
+		for(uint s=0; s<MG_STENCIL; s++)
+		{
+			solver_scalar v = fineMat[s*fineCount + f];
+			int4 nb = child + MgStencilOffset(s);
+			if(v == (solver_scalar)0 || !MgInside(nb, fine))
+				continue;
+			a[MgStencilIndex(nb/2 - cellI)] += v;
+		}
+	}
+
+	__global solver_scalar *out = mat + coarse.w * MG_STENCIL + cell;
+	for(uint s=0; s<MG_STENCIL; s++)
+		out[s*coarseCount] = a[s];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,29 @@
+R"(
+
+/*!
+ *	\brief	Add correction of coarser level to a multigrid level
+ */
+__kernel void MultigridProlongCells
+(
+	__global solver_scalar *x			: MG_X,
+	__global const solver_scalar *mat	: MG_MATRIX,
+	uint lvl					: MG_LEVEL
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 fine = MG_LEVELS[lvl];
+	uint4 coarse = MG_LEVELS[lvl+1];
+	uint fineCount = MgCells(fine);
+
+	if(cell >= fineCount)
+		return;
+
+	// cells without coefficients aren't corrected
+	if(mat[fine.w * MG_STENCIL + MG_CENTER * fineCount + cell] == (solver_scalar)0)
+		return;
+
+	int4 parent = MgCellCoords(cell, fine) / 2;
+	x[fine.w + cell] += x[coarse.w + MgCellIndex(parent, coarse)];
+}
+
+)" /* end OpenCL code */
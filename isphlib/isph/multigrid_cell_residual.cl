@@ -0,0 +1,37 @@
+R"(
+
+/*!
+ *	\brief	Residual of a multigrid level
+ */
+__kernel void MultigridCellResidual
+(
+	__global solver_scalar *r			: MG_R,
+	__global const solver_scalar *b	: MG_B,
+	__global const solver_scalar *x	: MG_X,
+	__global const solver_scalar *mat	: MG_MATRIX,
+	uint lvl					: MG_LEVEL
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 level = MG_LEVELS[lvl];
+	uint cellCount = MgCells(level);
+
+	if(cell >= cellCount)
+		return;
+
+	int4 cellI = MgCellCoords(cell, level);
+	__global const solver_scalar *m = mat + level.w * MG_STENCIL + cell;
+	__global const solver_scalar *xl = x + level.w;
+	solver_scalar sum = b[level.w + cell];
+
+	for(uint s=0; s<MG_STENCIL; s++)
+	{
+		int4 nb = cellI + MgStencilOffset(s);
+		if(MgInside(nb, level))
+			sum -= m[s*cellCount] * xl[MgCellIndex(nb, level)];
+	}
+
+	r[level.w + cell] = sum;
+}
+
+)" /* end OpenCL code */
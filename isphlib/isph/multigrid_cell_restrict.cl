@@ -0,0 +1,33 @@
+R"(
+
+/*!
+ *	\brief	Restrict residual of finer level to a multigrid level
+ */
+__kernel void MultigridRestrictCells
+(
+	__global solver_scalar *b			: MG_B,
+	__global const solver_scalar *r	: MG_R,
+	uint lvl					: MG_LEVEL
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 coarse = MG_LEVELS[lvl];
+	uint4 fine = MG_LEVELS[lvl-1];
+
+	if(cell >= MgCells(coarse))
+		return;
+
+	int4 cellI = MgCellCoords(cell, coarse);
+	solver_scalar sum = (solver_scalar)0;
+
+	for(uint c=0; c<MG_CHILDREN; c++)
+	{
+		int4 child = 2*cellI + (int4)(c & 1, (c >> 1) & 1, (c >> 2) & 1, 0);
+		if(MgInside(child, fine))
+			sum += r[fine.w + MgCellIndex(child, fine)];
+	}
+
+	b[coarse.w + cell] = sum;
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,34 @@
+R"(
+
+/*!
+ *	\brief	Damped Jacobi sweep on a multigrid level, initial one assumes zero guess
+ */
+__kernel void MultigridSmoothCells
+(
+	__global solver_scalar *x			: MG_X,
+	__global const solver_scalar *b	: MG_B,
+	__global const solver_scalar *r	: MG_R,
+	__global const solver_scalar *mat	: MG_MATRIX,
+	uint init					: MG_INIT,
+	uint lvl					: MG_LEVEL
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 level = MG_LEVELS[lvl];
+	uint cellCount = MgCells(level);
+
+	if(cell >= cellCount)
+		return;
+
+	size_t id = level.w + cell;
+	solver_scalar d = mat[level.w * MG_STENCIL + MG_CENTER * cellCount + cell];
+
+	if(d == (solver_scalar)0)
+		x[id] = (solver_scalar)0;
+	else if(init)
+		x[id] = MG_OMEGA * b[id] / d;
+	else
+		x[id] += MG_OMEGA * r[id] / d;
+}
+
+)" /* end OpenCL code */
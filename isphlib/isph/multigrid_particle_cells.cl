@@ -0,0 +1,22 @@
+R"(
+
+/*!
+ *	\brief	Store grid cell of each particle, cells group particles on the finest multigrid level
+ */
+__kernel void MultigridParticleCells
+(
+	__global uint *cells		: MG_PARTICLE_CELLS,
+	__global const int2 *hashes	: HASHES,
+	uint particleCount			: PARTICLE_COUNT
+)
+{
+	size_t k = get_global_id(0);
+
+	if(k >= particleCount)
+		return;
+
+	int2 hash = hashes[k];
+	cells[hash.y] = hash.x < 0 ? (uint)hash.x : MgGridCell(hash.x, MG_LEVELS[0]);
+}
+
+)" /* end OpenCL code */
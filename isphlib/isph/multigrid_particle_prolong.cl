@@ -0,0 +1,25 @@
+R"(
+
+/*!
+ *	\brief	Add coarse grid correction to particles
+ */
+__kernel void MultigridProlongParticles
+(
+	__global solver_scalar *z			: PRECONDITIONER_OUT,
+	__global const solver_scalar *x	: MG_X,
+	__global const uint *particleCells : MG_PARTICLE_CELLS,
+	__global const solver_scalar *diag	: PPE_DIAGONAL,
+	uint particleCount			: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	// rows without coefficients (dummies, fixed pressure) aren't corrected
+	if(diag[i] != (solver_scalar)0)
+		z[i] += x[MG_LEVELS[0].w + particleCells[i]];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,33 @@
+R"(
+
+/*!
+ *	\brief	Restrict particle residual to grid cells
+ */
+__kernel void MultigridRestrictParticles
+(
+	__global solver_scalar *b			: MG_B,
+	__global const solver_scalar *r	: PRECONDITIONER_IN,
+	__global const solver_scalar *az	: MG_PARTICLE_AX,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes : HASHES,
+	uint particleCount			: PARTICLE_COUNT
+)
+{
+	size_t cell = get_global_id(0);
+	uint4 level = MG_LEVELS[0];
+
+	if(cell >= MgCells(level))
+		return;
+
+	solver_scalar sum = (solver_scalar)0;
+	uint2 range = CellRange(cellRanges, hashes, MgGridHash(cell, level));
+	for(uint k=range.x; k<range.y; k++)
+	{
+		uint i = hashes[k].y;
+		sum += r[i] - az[i];
+	}
+
+	b[level.w + cell] = sum;
+}
+
+)" /* end OpenCL code */
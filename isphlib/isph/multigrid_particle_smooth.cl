@@ -0,0 +1,30 @@
+R"(
+
+/*!
+ *	\brief	Damped Jacobi sweep on particles, initial one assumes zero guess
+ */
+__kernel void MultigridSmoothParticles
+(
+	__global solver_scalar *z			: PRECONDITIONER_OUT,
+	__global const solver_scalar *r	: PRECONDITIONER_IN,
+	__global const solver_scalar *az	: MG_PARTICLE_AX,
+	__global const solver_scalar *diag	: PPE_DIAGONAL,
+	uint init					: MG_INIT,
+	uint particleCount			: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	solver_scalar dI = diag[i];
+	if(dI == (solver_scalar)0)
+		z[i] = (solver_scalar)0;
+	else if(init)
+		z[i] = MG_OMEGA * r[i] / dI;
+	else
+		z[i] += MG_OMEGA * (r[i] - az[i]) / dI;
+}
+
+)" /* end OpenCL code */
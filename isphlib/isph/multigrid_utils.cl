@@ -0,0 +1,89 @@
+R"(
+
+/*!
+ *	Multigrid hierarchy on the uniform grid. Level 0 are grid cells, indexed row-major like cell hashes
+ *	without MORTON_CELLS (MgGridCell and MgGridHash convert between them),
+ *	and each next level aggregates 2x2(x2) cells of the previous one. MG_LEVELS[l] holds cell counts
+ *	of level l in xyz, and its offset in level vectors in w. Coarse matrices are stored as stencils
+ *	of 3x3(x3) neighbor cells, k-th stencil coefficient of cell I on level l is at
+ *	MG_MATRIX[MG_LEVELS[l].w*MG_STENCIL + k*cells + I].
+ */
+
+#if DIM == 3
+#define MG_STENCIL 27
+#define MG_CHILDREN 8
+#else
+#define MG_STENCIL 9
+#define MG_CHILDREN 4
+#endif
+#define MG_CENTER (MG_STENCIL/2)
+
+// damping factor of Jacobi smoother
+#define MG_OMEGA ((solver_scalar)0.6)
+
+inline uint MgCells(uint4 level)
+{
+	return level.x * level.y * level.z;
+}
+
+inline int4 MgCellCoords(uint cell, uint4 level)
+{
+	return (int4)(cell % level.x, (cell / level.x) % level.y, cell / (level.x * level.y), 0);
+}
+
+inline uint MgCellIndex(int4 c, uint4 level)
+{
+	return c.x + (c.y + c.z * level.y) * level.x;
+}
+
+// level 0 index of grid cell with given hash, and back, since hashes may be in Morton order
+inline uint MgGridCell(uint hash, uint4 level)
+{
+#ifdef MORTON_CELLS
+#if DIM == 3
+	return MgCellIndex(CellCoords(hash), level);
+#else
+	return MgCellIndex((int4)(CellCoords(hash), 0, 0), level);
+#endif
+#else
+	return hash;
+#endif
+}
+
+inline uint MgGridHash(uint cell, uint4 level)
+{
+#ifdef MORTON_CELLS
+#if DIM == 3
+	return CellHash(MgCellCoords(cell, level));
+#else
+	return CellHash(MgCellCoords(cell, level).xy);
+#endif
+#else
+	return cell;
+#endif
+}
+
+inline bool MgInside(int4 c, uint4 level)
+{
+	return c.x >= 0 && c.y >= 0 && c.z >= 0 && c.x < (int)level.x && c.y < (int)level.y && c.z < (int)level.z;
+}
+
+inline int4 MgStencilOffset(uint k)
+{
+#if DIM == 3
+	return (int4)((int)(k % 3) - 1, (int)((k / 3) % 3) - 1, (int)(k / 9) - 1, 0);
+#else
+	return (int4)((int)(k % 3) - 1, (int)(k / 3) - 1, 0, 0);
+#endif
+}
+
+inline uint MgStencilIndex(int4 d)
+{
+#if DIM == 3
+	return (d.x + 1) + 3 * (d.y + 1) + 9 * (d.z + 1);
+#else
+	return (d.x + 1) + 3 * (d.y + 1);
+#endif
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,55 @@
+R"(
+
+/*!
+ *	\brief	Sum partial results of fused dot products and update pipelined CG scalars on device
+ *
+ *	gamma = (r,r) and delta = (w,r), where w = A.r
+ */
+__kernel void FinishPipelinedDotProducts
+(
+	__global solver_scalar *s			: KRYLOV_SCALARS,
+	__global const solver_scalar *part	: DOT_PAIR_OUT,
+	uint op						: KRYLOV_OP
+)
+{
+	if(get_global_id(0) > 0)
+		return;
+
+	solver_scalar gamma = (solver_scalar)0;
+	solver_scalar delta = (solver_scalar)0;
+	for(uint i=0; i<DOT_PARTIALS; i++)
+	{
+		gamma += part[i];
+		delta += part[DOT_PARTIALS + i];
+	}
+
+	if(op == KRYLOV_OP_INIT)
+	{
+		s[KRYLOV_RR_0] = gamma;
+		s[KRYLOV_DONE] = (solver_scalar)0;
+	}
+	else if(s[KRYLOV_DONE] != (solver_scalar)0)
+		return;
+
+	s[KRYLOV_RESIDUAL] = gamma;
+	if(fabs(gamma) <= PPE_TOLERANCE_SQ * fabs(s[KRYLOV_RR_0]))
+	{
+		s[KRYLOV_DONE] = (solver_scalar)1;
+		return;
+	}
+
+	if(op == KRYLOV_OP_INIT)
+	{
+		s[KRYLOV_BETA] = (solver_scalar)0;
+		s[KRYLOV_ALPHA] = gamma / delta;
+	}
+	else
+	{
+		solver_scalar beta = gamma / s[KRYLOV_RR];
+		s[KRYLOV_BETA] = beta;
+		s[KRYLOV_ALPHA] = gamma / (delta - beta * gamma / s[KRYLOV_ALPHA]);
+	}
+	s[KRYLOV_RR] = gamma;
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,47 @@
+R"(
+
+/*!
+ *	\brief	Update all pipelined CG vectors in one pass
+ */
+__kernel void UpdatePipelinedCG
+(
+	__global solver_scalar *x			: SOLUTION,
+	__global solver_scalar *r			: RESIDUAL,
+	__global solver_scalar *w			: PCG_W,
+	__global const solver_scalar *q	: PCG_Q,
+	__global solver_scalar *z			: PCG_Z,
+	__global solver_scalar *s			: PCG_S,
+	__global solver_scalar *p			: PCG_P,
+	__global const solver_scalar *k	: KRYLOV_SCALARS,
+	uint pc						: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i >= pc)
+		return;
+	if(k[KRYLOV_DONE] != (solver_scalar)0)
+		return;
+
+	solver_scalar alpha = k[KRYLOV_ALPHA];
+	solver_scalar beta = k[KRYLOV_BETA];
+
+	// in the first iteration previous directions are undefined
+	solver_scalar zI = q[i];
+	solver_scalar sI = w[i];
+	solver_scalar pI = r[i];
+	if(beta != (solver_scalar)0)
+	{
+		zI += beta * z[i];
+		sI += beta * s[i];
+		pI += beta * p[i];
+	}
+
+	z[i] = zI;
+	s[i] = sI;
+	p[i] = pI;
+	x[i] += alpha * pI;
+	r[i] -= alpha * sI;
+	w[i] -= alpha * zI;
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,48 @@
+R"(
+
+/*!
+ *	\brief	Pressure gradient term of each particle pair computed once, and added to both fluid particles
+ *
+ *	Runs over particles in cell order. Corrector step reads the sums and clears them.
+ */
+__kernel void PressureGradientPairs
+(
+	__global vector *gradP				: PRESSURE_GRADIENTS,
+	__global const scalar *sortedVol	: SORTED_VOLUMES,
+	__global const scalar *sortedPress	: SORTED_PRESSURES,
+	__global const char *typ			: CLASS,
+	__global const vector *sortedPos	: SORTED_POSITIONS,
+	__global const uint2 *cellRanges		: CELL_RANGES,
+	__global const int2 *hashes			: HASHES,
+	uint particleCount					: PARTICLE_COUNT
+)
+{
+	size_t _i = get_global_id(0);
+	if(_i >= particleCount) return;
+
+	int i = hashes[_i].y;
+	vector posI = sortedPos[_i];
+	bool fluidI = IsParticleFluid(typ[i]);
+	scalar podI = sortedPress[SORTED_I] * pown(sortedVol[SORTED_I],2);
+	vector gradPI = (vector)0;
+
+	ForEachSetup(posI)
+	ForEachPairNeighbor(hashes,cellRanges,sortedPos,posI)
+
+		bool fluidJ = IsParticleFluid(typ[j]);
+		if(fluidI || fluidJ)
+		{
+			// kernel gradient is antisymmetric, j gets the same term with opposite sign
+			vector f = (sortedPress[SORTED_J]*pown(sortedVol[SORTED_J],2) + podI) * SphKernelGrad(QSq, posDif);
+			gradPI += f;
+			if(fluidJ)
+				AtomicAddVector(&gradP[j], -f);
+		}
+
+	ForEachEnd
+
+	if(fluidI)
+		AtomicAddVector(&gradP[i], gradPI);
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,68 @@
+R"(
+
+/*!
+ *	\brief	Pressure gradient of corrector step, with neighbors staged to local memory per grid cell
+ */
+__kernel void PressureGradientTiled
+(
+	__global vector *gradP				: PRESSURE_GRADIENTS,
+	__global const scalar *sortedVol	: SORTED_VOLUMES,
+	__global const scalar *sortedPress	: SORTED_PRESSURES,
+	__global const char *typ			: CLASS,
+	__global const char *free_surface	: FREE_SURFACE,
+	__global const vector *sortedPos	: SORTED_POSITIONS,
+	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
+	__global const uint2 *cellRanges		: CELL_RANGES,
+	__global const int2 *hashes			: HASHES,
+	__local vector *tilePos				: LOCAL_SIZE_VECTOR,
+	__local scalar *tilePod				: LOCAL_SIZE_SCALAR,
+	__local char *tileFreeSurface		: LOCAL_SIZE_CHAR
+)
+{
+	ForEachTileParticle(hashes,cellRanges)
+
+		bool active = _validI && IsParticleFluid(typ[i]);
+		vector posI = active ? sortedPos[_i] : (vector)0;
+		scalar podI = active ? sortedPress[SORTED_I]*pown(sortedVol[SORTED_I],2) : (scalar)0;
+		char freeSurfaceI = active ? free_surface[i] : 0;
+#ifdef CORRECT_KERNEL
+		sym_tensor corrTensor = active ? kernelCorr[i] : (sym_tensor)0;
+#endif
+		vector gradPI = (vector)0;
+
+		ForEachTileNeighborChunk(hashes,cellRanges)
+
+			if(_validJ)
+			{
+				tilePos[_l] = sortedPos[_j];
+				tilePod[_l] = sortedPress[SORTED_J]*pown(sortedVol[SORTED_J],2);
+				tileFreeSurface[_l] = free_surface[j];
+			}
+			TileStaged
+
+			ForEachTileNeighbor(tilePos,posI,active)
+				vector gradW = SphKernelGrad(QSq, posDif);
+#ifdef CORRECT_KERNEL
+				gradW = CorrectGradW(gradW, corrTensor);
+#endif
+
+#ifdef STRONG_DIRICHLET
+				if(freeSurfaceI)
+					gradPI += (1.25*tilePod[_k]) * gradW;
+				else if(tileFreeSurface[_k])
+					gradPI += (2*podI) * gradW;
+				else
+#endif
+					gradPI += (tilePod[_k] + podI) * gradW;
+			ForEachTileNeighborEnd
+
+		ForEachTileNeighborChunkEnd
+
+		// corrector step reads and clears it
+		if(active)
+			gradP[i] = gradPI;
+
+	ForEachTileParticleEnd
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,91 @@
+R"(
+
+/*!
+ *	\brief	PPE residual of current pressure in simulation precision, rounded to solver precision as right hand side of correction
+ */
+__kernel void RefinementResidual
+(
+	__global solver_scalar *r		: SOLVER_RHS,
+	__global solver_scalar *d		: SOLUTION,
+	__global const scalar *rhs		: RHS,
+	__global const scalar *vol		: VOLUMES,
+	__global const scalar *sortedVol : SORTED_VOLUMES,
+	__global const char *typ		: CLASS,
+	__global const char *free_surface : FREE_SURFACE,
+	__global const scalar *p		: PRESSURES,
+	__global const scalar *sortedP	: SORTED_PRESSURES,
+	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes 	: HASHES,
+	uint particleCount				: PARTICLE_COUNT,
+	uint subtractProduct			: SUBTRACT_PRODUCT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	// correction is solved from zero initial guess
+	d[i] = (solver_scalar)0;
+
+	char type = typ[i];
+
+	if(!subtractProduct || IsParticleDummy(type)
+#ifdef STRONG_DIRICHLET
+	|| free_surface[i]
+#endif
+	)
+	{
+		r[i] = (solver_scalar)rhs[i];
+		return;
+	}
+
+	// same product as implicit matrix-vector product
+	vector posI = pos[i];
+	scalar pI = p[i];
+	scalar bI = (scalar)0;
+#ifdef CORRECT_KERNEL
+	sym_tensor corrTensor = kernelCorr[i];
+#endif
+	
+	ForEachSetup(posI)
+	
+	if(IsParticleWall(type))
+	{
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
+		if(IsParticleDummy(typ[j]))
+			continue;
+		
+		vector gradW = SphKernelGrad(QSq, posDif);
+#ifdef CORRECT_KERNEL
+		gradW = CorrectGradW(gradW, corrTensor);
+#endif
+		scalar aIJ = 1.0/vol[i] + 1.0/sortedVol[SORTED_J];
+		aIJ = dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
+		bI += aIJ * (pI - sortedP[SORTED_J]);
+	ForEachEnd
+	}
+	else if(IsParticleFluid(type))
+	{
+	if(free_surface[i])
+		pI *= 2;
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
+		vector gradW = SphKernelGrad(QSq, posDif);
+#ifdef CORRECT_KERNEL
+		gradW = CorrectGradW(gradW, corrTensor);
+#endif
+		scalar aIJ = 1.0/vol[i] + 1.0/sortedVol[SORTED_J];
+		aIJ = dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
+		bI += aIJ * (pI - sortedP[SORTED_J]);
+	ForEachEnd
+	}
+	
+	r[i] = (solver_scalar)(rhs[i] - 8 / MASS * bI);
+}
+
+)" /* end OpenCL code */
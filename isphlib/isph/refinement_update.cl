@@ -0,0 +1,19 @@
+R"(
+
+/*!
+ *	\brief	Add correction solved in solver precision to pressure
+ */
+__kernel void RefinementUpdate
+(
+	__global scalar *p				: PRESSURES,
+	__global const solver_scalar *d	: SOLUTION,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i < particleCount)
+		p[i] += d[i];
+}
+
+)" /* end OpenCL code */
@@ -5,33 +5,39 @@ R"(
  */
 __kernel void ShiftParticles
 (
-	__global vector *shiftedPos		: POSITIONS,
+	__global vector *shiftedPos		: POSITIONS_TEMP,
 	__global const scalar *vol		: VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const char *free_surface : FREE_SURFACE,
-	__global const vector *pos 		: POSITIONS_TEMP,
-	__global const vector *vel		: VELOCITIES_TEMP,
-	__global const uint *cellsStart : CELLS_START,
+	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const vector *vel		: VELOCITIES,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT,
 	scalar factor					: SHIFTING_FACTOR,
-	scalar dt 						: TIME_STEP
+	__global const scalar *timeSteps	: TIME_STEPS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_DT];
 	size_t i = get_global_id(0);
+	vector posI = pos[i];
+
+	// shifted positions are written out of place, unshifted particles are copied
+	shiftedPos[i] = posI;
 	if(i >= particleCount)
 		return;
 	if(!IsParticleFluid(typ[i]) || free_surface[i])
 		return;
 
-	vector posI = pos[i];
-
 	// 1st step: limit shifting radius for particles near free surface
 
 	scalar effRadiusSq = KERNEL_SUPPORT_SQ*SMOOTHING_LENGTH_SQ;
 
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 		if(free_surface[j] /*|| IsParticleWall(typ[j])*/)
 		{
 			scalar distSq = dot(posDif, posDif);
@@ -46,7 +52,7 @@ __kernel void ShiftParticles
 	scalar avgSpacing = (scalar)0;
 	vector shiftVec = (vector)0;
 
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 
 		scalar distSq = dot(posDif, posDif);
 		if(distSq > effRadiusSq)
@@ -69,7 +75,7 @@ __kernel void ShiftParticles
 	scalar velMagnitude = length(vel[i]);
 	//shiftVec *= factor * velMagnitude * dt;
 	shiftVec = normalize(shiftVec) * min(length(shiftVec)*factor*velMagnitude*dt, PARTICLE_SPACING);
-	shiftedPos[i] += shiftVec;
+	shiftedPos[i] = posI + shiftVec;
 }
 
 )" /* end OpenCL code */
@@ -2,23 +2,33 @@ R"(
 
 __kernel void ShiftParticlesUpdate
 (
-	__global vector *shiftedPos		: POSITIONS,
-	__global scalar *shiftedP		: PRESSURES,
-	__global vector *shiftedVel		: VELOCITIES,
+	__global scalar *shiftedP		: PRESSURES_TEMP,
+	__global vector *shiftedVel		: VELOCITIES_TEMP,
+	__global const vector *shiftedPos : POSITIONS_TEMP,
 	__global const scalar *vol		: VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const char *free_surface : FREE_SURFACE,
-	__global const vector *pos 		: POSITIONS_TEMP,
-	__global const scalar *p		: PRESSURES_TEMP,
-	__global const vector *vel		: VELOCITIES_TEMP,
-	__global const uint *cellsStart : CELLS_START,
+	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const scalar *p		: PRESSURES,
+	__global const vector *vel		: VELOCITIES,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT,
 	scalar factor					: SHIFTING_FACTOR,
-	scalar dt 						: TIME_STEP
+	__global const scalar *timeSteps	: TIME_STEPS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_DT];
 	size_t i = get_global_id(0);
+	vector velI = vel[i];
+	scalar pI = p[i];
+
+	// shifted values are written out of place, unshifted particles are copied
+	shiftedP[i] = pI;
+	shiftedVel[i] = velI;
 	if(i >= particleCount)
 		return;
 	if(!IsParticleFluid(typ[i]) || free_surface[i])
@@ -30,11 +40,9 @@ __kernel void ShiftParticlesUpdate
 	vector gp = (vector)0;
 	vector gvx = (vector)0;
 	vector gvy = (vector)0;
-	vector velI = vel[i];
-	scalar pI = p[i];
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 		/*scalar c = vol[j] * SphKernel(QSq);
 		new_p += c * p[j];
 		new_vel += c * vel[j];*/
@@ -46,8 +54,8 @@ __kernel void ShiftParticlesUpdate
 	ForEachEnd
 	
 	vector dr = shiftedPos[i] - posI;
-	shiftedP[i] += dot(gp, dr);
-	shiftedVel[i] += (vector)(dot(gvx, dr), dot(gvy, dr));
+	shiftedP[i] = pI + dot(gp, dr);
+	shiftedVel[i] = velI + (vector)(dot(gvx, dr), dot(gvy, dr));
 	
 	/*shiftedP[i] = new_p;
 	shiftedVel[i] = new_vel;*/
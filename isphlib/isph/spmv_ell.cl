@@ -0,0 +1,35 @@
+R"(
+
+/*!
+ *	\brief	Matrix-vector multiplication with PPE matrix assembled in ELLPACK format
+ */
+__kernel void SparseMatrixVectorProduct
+(
+	__global solver_scalar *out			: TMP,
+	__global const solver_scalar *vec		: CONJUGATE,
+	__global const solver_scalar *sortedVec : SORTED_CONJUGATE,
+	__global const uint *cols		: PPE_COLUMNS,
+	__global const solver_scalar *values	: PPE_VALUES,
+	__global const solver_scalar *diag		: PPE_DIAGONAL,
+	__global const uint *rowLengths	: PPE_ROW_LENGTHS,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+
+	if(i >= particleCount)
+		return;
+
+	solver_scalar bI = diag[i] * vec[i];
+	uint rowLength = rowLengths[i];
+
+	for(uint k=0; k<rowLength; k++)
+	{
+		size_t e = k*PPE_STRIDE + i;
+		bI += values[e] * sortedVec[cols[e]];
+	}
+
+	out[i] = bI;
+}
+
+)" /* end OpenCL code */
@@ -7,12 +7,17 @@ __kernel void MatrixVectorProduct
 (
 	__global scalar *out			: TMP,
 	__global const scalar *vol		: VOLUMES,
+	__global const scalar *sortedVol : SORTED_VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const char *free_surface : FREE_SURFACE,
 	__global const scalar *vec		: CONJUGATE,
+	__global const scalar *sortedVec : SORTED_CONJUGATE,
 	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
 	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT
 )
@@ -49,7 +54,7 @@ __kernel void MatrixVectorProduct
 	
 	if(IsParticleWall(type))
 	{
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 		//if(!IsParticleFluid(typ[j]))
 		if(IsParticleDummy(typ[j]) /*|| free_surface[j]*/)
 			continue;
@@ -60,16 +65,16 @@ __kernel void MatrixVectorProduct
 #endif
 		//scalar aIJ = dot(gradW, posDif) / ((dot(posDif,posDif) + DIST_EPSILON));
 		//bI += aIJ * (vecI - vec[j]) * vol[j];
-		scalar aIJ = 1.0/vol[i] + 1.0/vol[j];
+		scalar aIJ = 1.0/vol[i] + 1.0/sortedVol[SORTED_J];
 		aIJ = dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
-		bI += aIJ * (vecI - vec[j]);
+		bI += aIJ * (vecI - sortedVec[SORTED_J]);
 	ForEachEnd
 	}
 	else if(IsParticleFluid(type))
 	{
 	if(free_surface[i])
 		vecI *= 2;
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 		/*if(IsParticleDummy(typ[j]))
 			continue;*/
 		/*if(free_surface[i] && !IsParticleFluid(typ[j]))
@@ -80,9 +85,9 @@ __kernel void MatrixVectorProduct
 #endif
 		//scalar aIJ = dot(gradW, posDif) / ((dot(posDif,posDif) + DIST_EPSILON));
 		//bI += aIJ * (vecI - vec[j]) * vol[j];
-		scalar aIJ = 1.0/vol[i] + 1.0/vol[j];
+		scalar aIJ = 1.0/vol[i] + 1.0/sortedVol[SORTED_J];
 		aIJ = dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
-		bI += aIJ * (vecI - vec[j]);
+		bI += aIJ * (vecI - sortedVec[SORTED_J]);
 
 	ForEachEnd
 	}
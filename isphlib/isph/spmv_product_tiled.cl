@@ -0,0 +1,84 @@
+R"(
+
+/*!
+ *	\brief	Implicit matrix-vector multiplication, with neighbors staged to local memory per grid cell
+ */
+__kernel void MatrixVectorProductTiled
+(
+	__global scalar *out			: TMP,
+	__global const scalar *vol		: VOLUMES,
+	__global const scalar *sortedVol : SORTED_VOLUMES,
+	__global const char *typ		: CLASS,
+	__global const char *free_surface : FREE_SURFACE,
+	__global const scalar *vec		: CONJUGATE,
+	__global const scalar *sortedVec : SORTED_CONJUGATE,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes 	: HASHES,
+	uint particleCount				: PARTICLE_COUNT,
+	__local vector *tilePos			: LOCAL_SIZE_VECTOR,
+	__local scalar *tileVolInv		: LOCAL_SIZE_SCALAR,
+	__local scalar *tileVec			: LOCAL_SIZE_SCALAR,
+	__local char *tileType			: LOCAL_SIZE_CHAR
+)
+{
+	// last group handles particles out of grid, sorted after all cells
+	if(get_group_id(0) == CELL_TOTAL)
+	{
+		for(int k = (int)particleCount - 1 - (int)get_local_id(0); k >= 0 && hashes[k].x < 0; k -= TILE_SIZE)
+			out[hashes[k].y] = (scalar)0;
+		return;
+	}
+
+	ForEachTileParticle(hashes,cellRanges)
+
+		char type = _validI ? typ[i] : NONE_PARTICLE;
+		bool active = IsParticleFluid(type) || IsParticleWall(type);
+#ifdef STRONG_DIRICHLET
+		active = active && !free_surface[i];
+#endif
+		bool wallI = IsParticleWall(type);
+		vector posI = active ? sortedPos[_i] : (vector)0;
+		scalar vecI = active ? vec[i] : (scalar)0;
+		scalar volInvI = active ? 1.0/vol[i] : (scalar)0;
+		if(IsParticleFluid(type) && free_surface[i])
+			vecI *= 2;
+#ifdef CORRECT_KERNEL
+		sym_tensor corrTensor = active ? kernelCorr[i] : (sym_tensor)0;
+#endif
+		scalar bI = (scalar)0;
+
+		ForEachTileNeighborChunk(hashes,cellRanges)
+
+			if(_validJ)
+			{
+				tilePos[_l] = sortedPos[_j];
+				tileVolInv[_l] = 1.0/sortedVol[SORTED_J];
+				tileVec[_l] = sortedVec[SORTED_J];
+				tileType[_l] = typ[j];
+			}
+			TileStaged
+
+			ForEachTileNeighbor(tilePos,posI,active)
+				if(wallI && IsParticleDummy(tileType[_k]))
+					continue;
+
+				vector gradW = SphKernelGrad(QSq, posDif);
+#ifdef CORRECT_KERNEL
+				gradW = CorrectGradW(gradW, corrTensor);
+#endif
+				scalar aIJ = volInvI + tileVolInv[_k];
+				aIJ = dot(gradW, posDif) / (aIJ*aIJ*((dot(posDif,posDif) + DIST_EPSILON)));
+				bI += aIJ * (vecI - tileVec[_k]);
+			ForEachTileNeighborEnd
+
+		ForEachTileNeighborChunkEnd
+
+		if(_validI)
+			out[i] = active ? 8 / MASS * bI : (scalar)0;
+
+	ForEachTileParticleEnd
+}
+
+)" /* end OpenCL code */
@@ -4,15 +4,20 @@ R"(
  */
 __kernel void TempPositions
 (
-	__global vector *pos		: POSITIONS,
-	__global const char *typ	: CLASS,
-	__global const vector *vel	: VELOCITIES,
-	scalar dt					: TIME_STEP
+	__global vector *pos			: POSITIONS,
+	__global const vector *oldPos	: POSITIONS_OLD,
+	__global const char *typ		: CLASS,
+	__global const vector *vel		: VELOCITIES,
+	__global const scalar *timeSteps	: TIME_STEPS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_DT];
 	size_t i = get_global_id(0);
+	// out of place, positions buffer is swapped with old positions before
 	if(IsParticleFluid(typ[i]))
-		pos[i] += vel[i] * dt;
+		pos[i] = oldPos[i] + vel[i] * dt;
+	else
+		pos[i] = oldPos[i];
 }
 
 )" /* end OpenCL code */
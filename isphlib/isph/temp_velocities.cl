@@ -11,13 +11,17 @@ __kernel void TempVelocities
 	__global const scalar *vol		: VOLUMES,
 	__global const char *typ		: CLASS,
 	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
 	__global const sym_tensor *kernelCorr : KERNEL_CORRECTION,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT,
-	scalar dt 						: TIME_STEP
+	__global const scalar *timeSteps	: TIME_STEPS
 )
 {
+	scalar dt = timeSteps[TIME_STEP_DT];
 	size_t i = get_global_id(0);
 	if(i >= particleCount)
 		return;
@@ -37,7 +41,7 @@ __kernel void TempVelocities
 #endif
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
 
 		vector velDif = velI - vel[j];
 		vector gradW = SphKernelGrad(QSq, posDif);
@@ -0,0 +1,98 @@
+R"(
+
+/*!
+ *	\brief	Calculate kernel correction and intermediate velocities without pressure factor in single neighbor pass
+ *
+ *	Viscous term is linear in correction tensor, so neighbor sums are kept per velocity component
+ *	and contracted with the tensor once it's known at the end of the pass.
+ */
+__kernel void TempVelocitiesCorrected
+(
+	__global char *free_surface 	: FREE_SURFACE,
+	__global vector *vel 			: VELOCITIES,
+	__global scalar *divP			: DIV_POS,
+	__global sym_tensor *kernelCorr	: KERNEL_CORRECTION,
+	__global const scalar *vol		: VOLUMES,
+	__global const char *typ		: CLASS,
+	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes 	: HASHES,
+	uint particleCount				: PARTICLE_COUNT,
+	__global const scalar *timeSteps	: TIME_STEPS
+)
+{
+	scalar dt = timeSteps[TIME_STEP_DT];
+	size_t i = get_global_id(0);
+	if(i >= particleCount)
+		return;
+	
+	char type = typ[i];
+
+	if(IsParticleDummy(type))
+	{
+		free_surface[i] = 0;
+		return;
+	}
+
+	bool fluid = IsParticleFluid(type);
+	vector posI = pos[i];
+	vector velI = vel[i];
+	scalar divPos = (scalar)0;
+	sym_tensor moments = (sym_tensor)0;
+	sym_tensor accX = (sym_tensor)0;
+	sym_tensor accY = (sym_tensor)0;
+#if DIM == 3
+	sym_tensor accZ = (sym_tensor)0;
+#endif
+	
+	ForEachSetup(posI)
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
+
+		vector gradW = SphKernelGrad(QSq, posDif);
+		moments += KernelMoment(gradW, posDif);
+
+		if(fluid)
+		{
+			// position divergence, needs uncorrected kernel gradient
+			divPos -= dot(gradW, posDif);
+
+			// viscous acceleration, before contraction with correction tensor
+			vector velDif = (velI - vel[j]) * vol[j] / ((dot(posDif,posDif) + DIST_EPSILON));
+			sym_tensor gradPos = SymOuter(gradW, posDif);
+			accX += velDif.x * gradPos;
+			accY += velDif.y * gradPos;
+#if DIM == 3
+			accZ += velDif.z * gradPos;
+#endif
+		}
+
+	ForEachEnd
+	
+	sym_tensor corrTensor = KernelCorrectionTensor(moments);
+	kernelCorr[i] = corrTensor;
+
+	if(!fluid)
+	{
+		free_surface[i] = 0;
+		return;
+	}
+
+#if DIM == 3
+	vector accI = make_vector(SymContract(corrTensor, accX), SymContract(corrTensor, accY), SymContract(corrTensor, accZ));
+#else
+	vector accI = make_vector(SymContract(corrTensor, accX), SymContract(corrTensor, accY));
+#endif
+	accI *= 2 * DYNAMIC_VISCOSITY * vol[i] / MASS;
+	accI += GRAVITY;
+	
+	vel[i] = velI + dt * accI;
+	
+	divPos *= VOLUME;
+	divP[i] = divPos;
+	free_surface[i] = (divPos < FREE_SURFACE_FACTOR) ? 1 : 0;
+}
+
+)" /* end OpenCL code */
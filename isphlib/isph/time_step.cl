@@ -0,0 +1,33 @@
+R"(
+
+/*!
+ *	\brief	Choose time step from CFL and viscous conditions on device
+ */
+__kernel void IsphTimeStep
+(
+	__global scalar *ts					: TIME_STEPS,
+	__global const scalar *maxVelSq		: OUT_MAX_VELOCITIES,
+	scalar wantedDt						: WANTED_TIME_STEP,
+	scalar cflFactor					: CFL_FACTOR
+)
+{
+	scalar dt = wantedDt;
+
+	if(dt <= (scalar)0)
+	{
+		// first step has no velocity to limit it
+		scalar dtCfl = (scalar)1e-6;
+		if(ts[TIME_STEP_DT] > (scalar)0)
+		{
+			scalar maxVel = (scalar)0;
+			for(uint i=0; i<MAX_VELOCITY_PARTIALS; i++)
+				maxVel = max(maxVel, maxVelSq[i]);
+			dtCfl = maxVel > (scalar)0 ? (scalar)0.2 * PARTICLE_SPACING / sqrt(maxVel) : (scalar)1e-3;
+		}
+		dt = cflFactor * min(min(dtCfl, (scalar)VISCOUS_TIME_STEP), (scalar)1e-3);
+	}
+
+	StartTimeStep(ts, dt);
+}
+
+)" /* end OpenCL code */
@@ -11,6 +11,9 @@ QMAKE_CXXFLAGS = -stdlib=libc++ -std=c++11
 QMAKE_CXXFLAGS_RELEASE = -O3
 QMAKE_CXXFLAGS_DEBUG = -O0 -g
 
+# qmake CONFIG+=no_debug_log compiles out debug log messages
+no_debug_log: DEFINES += ISPH_NO_DEBUG_LOG
+
 INCLUDEPATH += /usr/include/c++/v1 ./extern
 
 HEADERS += \ 
@@ -113,6 +116,7 @@ OTHER_FILES += \
     general/obj_pos.cl \
     general/obj_pos_vel.cl \
     general/obj_vel.cl \
+    general/time_step.cl \
     general/types.cl \
     integrators/wcsph_corrector.cl \
     integrators/wcsph_euler.cl \
@@ -121,24 +125,56 @@ OTHER_FILES += \
     integrators/wcsph_rkstep42.cl \
     integrators/wcsph_rkstep43.cl \
     integrators/wcsph_rkstep44.cl \
+    isph/assemble_matrix.cl \
     isph/bicgstab_update_conjugate_0.cl \
+    isph/bicgstab_update_conjugate_0_device.cl \
     isph/bicgstab_update_conjugate_1.cl \
+    isph/bicgstab_update_conjugate_1_device.cl \
     isph/bicgstab_update_result.cl \
+    isph/bicgstab_update_result_device.cl \
     isph/build_rhs.cl \
     isph/calc_volumes.cl \
     isph/cg_update_conjugate.cl \
+    isph/cg_update_conjugate_device.cl \
     isph/cg_update_result.cl \
+    isph/cg_update_result_device.cl \
     isph/correct.cl \
     isph/div_vel.cl \
     isph/dot.cl \
+    isph/dot_pair.cl \
     isph/dummy_scalar_copy.cl \
+    isph/dummy_solver_scalar_copy.cl \
     isph/dummy_vector_copy.cl \
     isph/fix_pressure.cl \
+    isph/initial_residual.cl \
+    isph/jacobi_preconditioner.cl \
+    isph/krylov_scalars.cl \
+    isph/multigrid_assemble_cells.cl \
+    isph/multigrid_assemble_coarse.cl \
+    isph/multigrid_cell_prolong.cl \
+    isph/multigrid_cell_residual.cl \
+    isph/multigrid_cell_restrict.cl \
+    isph/multigrid_cell_smooth.cl \
+    isph/multigrid_particle_cells.cl \
+    isph/multigrid_particle_prolong.cl \
+    isph/multigrid_particle_restrict.cl \
+    isph/multigrid_particle_smooth.cl \
+    isph/multigrid_utils.cl \
+    isph/pipelined_cg_scalars.cl \
+    isph/pipelined_cg_update.cl \
+    isph/pressure_gradient_pairs.cl \
+    isph/pressure_gradient_tiled.cl \
+    isph/refinement_residual.cl \
+    isph/refinement_update.cl \
     isph/shifting.cl \
     isph/shifting_update.cl \
+    isph/spmv_ell.cl \
     isph/spmv_product.cl \
+    isph/spmv_product_tiled.cl \
     isph/temp_positions.cl \
     isph/temp_velocities.cl \
+    isph/temp_velocities_corrected.cl \
+    isph/time_step.cl \
     kernels/correction.cl \
     kernels/cubic.cl \
     kernels/delta_p.cl \
@@ -146,16 +182,30 @@ OTHER_FILES += \
     kernels/gaussmod.cl \
     kernels/quadratic.cl \
     kernels/quintic.cl \
+    kernels/tabulated.cl \
     kernels/wendland.cl \
     scene/grid_cellids.cl \
+    scene/grid_cellids_update.cl \
     scene/grid_cellstart.cl \
     scene/grid_clear.cl \
+    scene/grid_clear_occupied.cl \
+    scene/grid_reorder_scalar.cl \
+    scene/grid_reorder_solver_scalar.cl \
+    scene/grid_reorder_vector.cl \
+    scene/grid_sort_merge.cl \
+    scene/grid_sort_split.cl \
     scene/grid_utils.cl \
+    scene/neighbor_lists_build.cl \
+    scene/neighbor_lists_displacement.cl \
     scene/out_of_bounds.cl \
     wcsph/acceleration.cl \
+    wcsph/acceleration_finish.cl \
+    wcsph/acceleration_pairs.cl \
     wcsph/accelerations_colagrossi.cl \
     wcsph/cfl.cl \
     wcsph/continuity.cl \
+    wcsph/continuity_finish.cl \
+    wcsph/continuity_pairs.cl \
     wcsph/continuity_colagrossi.cl \
     wcsph/init.cl \
     wcsph/MLS_post.cl \
@@ -165,4 +215,5 @@ OTHER_FILES += \
     wcsph/set_masses.cl \
     wcsph/shepard_filter.cl \
     wcsph/tait_eos.cl \
-    wcsph/tait_eos_inv.cl
+    wcsph/tait_eos_inv.cl \
+    wcsph/time_step.cl
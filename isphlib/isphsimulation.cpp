@@ -9,12 +9,26 @@ IsphSimulation::IsphSimulation(unsigned int simDimensions, VariableDataType scal
 	, projectionOrder(1)
 	, solverType(CG)
 	, maxIterations(100)
+	, maxRefinements(10)
 	, solvingTolerance(0.001)
+	, assembledMatrix(true)
+	, deviceSolverScalars(true)
+	, solverCheckInterval(5)
+	, preconditioner(NoPreconditioner)
+	, warmStart(false)
 	, freeSurfaceFactor(simDimensions==2 ? 1.5 : 2.4)
 	, shifting(false)
 	, shiftingFactor(0.04)
 	, shiftingFrequency(1)
 	, strongDirichletBC(false)
+	, pairwisePressureGradient(false)
+	, matrixVectorSubprogram(NULL)
+	, dotSubprogram(NULL)
+	, finishDotSubprogram(NULL)
+	, dotPairSubprogram(NULL)
+	, jacobiSubprogram(NULL)
+	, dummyScalarSubprogram(NULL)
+	, dummySolverScalarSubprogram(NULL)
 {
 }
 
@@ -44,20 +58,60 @@ bool IsphSimulation::InitSph()
 	if(strongDirichletBC)
 		program->AddBuildOption("-D STRONG_DIRICHLET");
 
+	if(pairwisePressureGradient)
+	{
+		CLDevice* device = this->Devices()->Device(0);
+		if(SmoothingKernelCorrection() || strongDirichletBC)
+		{
+			Log::Send(Log::Warning, "Pressure gradient isn't antisymmetric with kernel correction or strong Dirichlet BC. Computing it per particle.");
+			pairwisePressureGradient = false;
+		}
+		else if(!device->GlobalAtomics() || (this->ScalarDataType() == DoubleType && !device->GlobalAtomics64()))
+		{
+			Log::Send(Log::Warning, "Device doesn't support atomics needed for pair-wise pressure gradient. Computing it per particle.");
+			pairwisePressureGradient = false;
+		}
+		else
+		{
+			program->AddBuildOption("-D PAIRWISE_ATOMICS");
+			program->AddBuildOption("-D SUMMED_PRESSURE_GRADIENT");
+		}
+	}
+
+	// without pair-wise kernel, tiled kernel computes the gradient the corrector reads
+	if(this->TiledKernels() && !pairwisePressureGradient)
+		program->AddBuildOption("-D SUMMED_PRESSURE_GRADIENT");
+
+	this->InitSimulationBuffer("PRESSURE_GRADIENTS", this->VectorDataType(), (pairwisePressureGradient || this->TiledKernels()) ? this->deviceParticleCount : 1);
+
 	// vars
 	this->InitSimulationVariable("FREE_SURFACE_FACTOR", this->ScalarDataType(), freeSurfaceFactor, true);
 	this->InitSimulationVariable("SHIFTING_FACTOR", this->ScalarDataType(), shiftingFactor, true);
+	this->InitSimulationVariable("VISCOUS_TIME_STEP", this->ScalarDataType(), 0.2 * smoothingLength * smoothingLength * density / (dynamicViscosity + 1e-10), true);
 
 	// subprograms
+   this->LoadSubprogram("time step",
+                        #include "isph/time_step.cl"
+                        );
    this->LoadSubprogram("calc volumes",
                         #include "isph/calc_volumes.cl"
                         );
    this->LoadSubprogram("temp positions",
                         #include "isph/temp_positions.cl"
                         );
-   this->LoadSubprogram("temp velocities",
-                        #include "isph/temp_velocities.cl"
-                        );
+	if(SmoothingKernelCorrection())
+	{
+		// kernel correction is computed in the same neighbor pass
+      this->LoadSubprogram("temp velocities",
+                           #include "isph/temp_velocities_corrected.cl"
+                           );
+	}
+	else
+	{
+      this->LoadSubprogram("temp velocities",
+                           #include "isph/temp_velocities.cl"
+                           );
+	}
    this->LoadSubprogram("build rhs",
                         #include "isph/build_rhs.cl"
                         );
@@ -66,19 +120,43 @@ bool IsphSimulation::InitSph()
                         );
    this->LoadSubprogram("dummy vector copy",
                         #include "isph/dummy_vector_copy.cl"
-                        );
-   this->LoadSubprogram("matrix-vector product",
-                        #include "isph/spmv_product.cl"
-                        );
+                        , false);
+	if(this->TiledKernels())
+	{
+      this->LoadSubprogram("matrix-vector product",
+                           #include "isph/spmv_product_tiled.cl"
+                           );
+	}
+	else
+	{
+      this->LoadSubprogram("matrix-vector product",
+                           #include "isph/spmv_product.cl"
+                           );
+	}
    this->LoadSubprogram("corrector step",
                         #include "isph/correct.cl"
                         );
+	if(pairwisePressureGradient)
+	{
+      this->LoadSubprogram("pressure gradient pairs",
+                           #include "isph/pressure_gradient_pairs.cl"
+                           );
+	}
+	else if(this->TiledKernels())
+	{
+      this->LoadSubprogram("pressure gradient tiled",
+                           #include "isph/pressure_gradient_tiled.cl"
+                           );
+	}
    this->LoadSubprogram("velocity divergence",
                         #include "isph/div_vel.cl"
-                        );
+                        , false);
    this->LoadSubprogram("fix pressure",
                         #include "isph/fix_pressure.cl"
-                        );
+                        , false);
+
+	// tensile correction is used only by WCSPH
+	this->Subprogram("deltaP")->SetEnabled(false);
 	if(shifting)
 	{
 		this->InitSimulationBuffer("VELOCITIES_TEMP", this->VectorDataType(), this->deviceParticleCount);
@@ -95,55 +173,232 @@ bool IsphSimulation::InitSph()
 
 	// PPE solvers
 	this->InitSimulationBuffer("RHS", this->ScalarDataType(), this->deviceParticleCount);
-	this->InitSimulationBuffer("SORTED_PRESSURES", this->ScalarDataType(), this->deviceParticleCount);
-	this->InitSimulationBuffer("RESIDUAL", this->ScalarDataType(), this->deviceParticleCount);
-	this->InitSimulationVariable("CG_ALPHA", this->ScalarDataType(), false);
-	this->InitSimulationVariable("CG_BETA", this->ScalarDataType(), false);
+	this->InitSimulationBuffer("RESIDUAL", this->SolverScalarDataType(), this->deviceParticleCount);
+	this->InitSimulationVariable("CG_ALPHA", this->SolverScalarDataType(), false);
+	this->InitSimulationVariable("CG_BETA", this->SolverScalarDataType(), false);
+
+	if(MixedPrecision())
+	{
+		// outer refinement solves for correction, rounded residual is its right hand side
+		this->InitSimulationBuffer("SOLVER_RHS", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("PRESSURE_CORRECTION", this->SolverScalarDataType(), this->deviceParticleCount);
+		program->ConnectSemantic("SOLUTION", program->Buffer("PRESSURE_CORRECTION"));
+		this->InitSimulationVariable("SUBTRACT_PRODUCT", UintType, false);
+      this->LoadSubprogram("refinement residual",
+                           #include "isph/refinement_residual.cl"
+                           );
+      this->LoadSubprogram("refinement update",
+                           #include "isph/refinement_update.cl"
+                           );
+      this->LoadSubprogram("dummy solver scalar copy",
+                           #include "isph/dummy_solver_scalar_copy.cl"
+                           );
+
+		if(!assembledMatrix)
+		{
+			Log::Send(Log::Warning, "Mixed precision solver needs assembled matrix. Assembling PPE matrix.");
+			assembledMatrix = true;
+		}
+	}
+	else
+	{
+		program->ConnectSemantic("SOLVER_RHS", program->Buffer("RHS"));
+		program->ConnectSemantic("SOLUTION", program->Buffer("PRESSURES"));
+	}
+
+	if(assembledMatrix)
+	{
+		unsigned int rowWidth = this->NeighborCapacity(this->supportRadius);
+		this->InitSimulationBuffer("PPE_COLUMNS", UintType, rowWidth * this->deviceParticleCount);
+		this->InitSimulationBuffer("PPE_VALUES", this->SolverScalarDataType(), rowWidth * this->deviceParticleCount);
+		this->InitSimulationBuffer("PPE_DIAGONAL", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("PPE_ROW_LENGTHS", UintType, this->deviceParticleCount);
+		this->InitSimulationBuffer("PPE_ROW_OVERFLOW", UintType, 1);
+		this->InitSimulationVariable("PPE_ROW_WIDTH", UintType, rowWidth, true);
+		this->InitSimulationVariable("PPE_STRIDE", UintType, this->deviceParticleCount, true);
+      this->LoadSubprogram("assemble matrix",
+                           #include "isph/assemble_matrix.cl"
+                           );
+      this->LoadSubprogram("sparse matrix-vector product",
+                           #include "isph/spmv_ell.cl"
+                           );
+	}
+
+	if(solverType == PipelinedCG && preconditioner != NoPreconditioner)
+	{
+		Log::Send(Log::Warning, "Pipelined CG solver doesn't support preconditioning. Solving without preconditioner.");
+		preconditioner = NoPreconditioner;
+	}
+
+	if(warmStart)
+		program->AddBuildOption("-D WARM_START");
+
+	if(KrylovWarmStart())
+	{
+      this->LoadSubprogram("initial residual",
+                           #include "isph/initial_residual.cl"
+                           );
+	}
+
+	if(preconditioner == MultigridPreconditioner && !assembledMatrix)
+	{
+		Log::Send(Log::Warning, "Multigrid preconditioner needs assembled matrix. Using Jacobi preconditioner.");
+		preconditioner = JacobiPreconditioner;
+	}
+
+	if(preconditioner == MultigridPreconditioner)
+	{
+		if(!InitMultigrid())
+			return false;
+	}
+	else if(preconditioner == JacobiPreconditioner)
+	{
+		if(!assembledMatrix)
+		{
+			this->InitSimulationBuffer("PPE_DIAGONAL", this->SolverScalarDataType(), this->deviceParticleCount);
+			program->AddBuildOption("-D RHS_DIAGONAL");
+		}
+      this->LoadSubprogram("jacobi preconditioner",
+                           #include "isph/jacobi_preconditioner.cl"
+                           );
+	}
+	else if(!assembledMatrix)
+		this->InitSimulationBuffer("PPE_DIAGONAL", this->SolverScalarDataType(), 1); // dummy buffer for kernel args
 
    LoadSubprogram("dot product",
                   #include "isph/dot.cl"
                   );
-	InitSimulationBuffer("DOT_OUT", ScalarDataType(), 2 * Devices()->Device(0)->ComputeUnits());
-	CLLocalBuffer *var = new CLLocalBuffer(program, "LOCAL_DOT");  var->SetSpace(ScalarDataType(), 2 * 256);
+	InitSimulationBuffer("DOT_OUT", SolverScalarDataType(), 2 * Devices()->Device(0)->ComputeUnits());
+	CLLocalBuffer *var = new CLLocalBuffer(program, "LOCAL_DOT");  var->SetSpace(SolverScalarDataType(), 2 * 256);
 
-	if(solverType == CG)
+	if(deviceSolverScalars || solverType == PipelinedCG)
 	{
-		this->InitSimulationBuffer("CONJUGATE", this->ScalarDataType(), this->deviceParticleCount);
-		this->InitSimulationBuffer("TMP", this->ScalarDataType(), this->deviceParticleCount);
-      this->LoadSubprogram("update result and residual",
-                           #include "isph/cg_update_result.cl"
-                           );
-      this->LoadSubprogram("update conjugate",
-                           #include "isph/cg_update_conjugate.cl"
+		this->InitSimulationBuffer("KRYLOV_SCALARS", this->SolverScalarDataType(), KrylovScalarCount);
+		this->InitSimulationVariable("KRYLOV_OP", UintType, false);
+		this->InitSimulationVariable("DOT_PARTIALS", UintType, program->Buffer("DOT_OUT")->Elements(), true);
+		this->InitSimulationVariable("PPE_TOLERANCE_SQ", this->SolverScalarDataType(), KrylovTolerance() * KrylovTolerance(), true);
+      this->LoadSubprogram("finish dot product",
+                           #include "isph/krylov_scalars.cl"
                            );
+	}
+
+	if(solverType == CG)
+	{
+		this->InitSimulationBuffer("CONJUGATE", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("TMP", this->SolverScalarDataType(), this->deviceParticleCount);
+		if(preconditioner != NoPreconditioner)
+			this->InitSimulationBuffer("PRECONDITIONED", this->SolverScalarDataType(), this->deviceParticleCount);
+		else
+			program->ConnectSemantic("PRECONDITIONED", program->Buffer("RESIDUAL"));
+		if(deviceSolverScalars)
+		{
+         this->LoadSubprogram("update result and residual",
+                              #include "isph/cg_update_result_device.cl"
+                              );
+         this->LoadSubprogram("update conjugate",
+                              #include "isph/cg_update_conjugate_device.cl"
+                              );
+		}
+		else
+		{
+         this->LoadSubprogram("update result and residual",
+                              #include "isph/cg_update_result.cl"
+                              );
+         this->LoadSubprogram("update conjugate",
+                              #include "isph/cg_update_conjugate.cl"
+                              );
+		}
 		program->ConnectSemantic("DOT_1", program->Buffer("TMP"));
 		program->ConnectSemantic("DOT_2", program->Buffer("CONJUGATE"));
 	}
 	else if(solverType == BiCGSTAB)
 	{
-		this->InitSimulationVariable("CG_OMEGA", this->ScalarDataType(), false);
-		this->InitSimulationBuffer("CONJUGATE_0", this->ScalarDataType(), this->deviceParticleCount);
-		this->InitSimulationBuffer("CONJUGATE_1", this->ScalarDataType(), this->deviceParticleCount);
-		this->InitSimulationBuffer("TMP_0", this->ScalarDataType(), this->deviceParticleCount);
-		this->InitSimulationBuffer("TMP_1", this->ScalarDataType(), this->deviceParticleCount);
-      this->LoadSubprogram("update result and residual",
-                           #include "isph/bicgstab_update_result.cl"
-                           );
-      this->LoadSubprogram("update conjugate 0",
-                           #include "isph/bicgstab_update_conjugate_0.cl"
-                           );
-      this->LoadSubprogram("update conjugate 1",
-                           #include "isph/bicgstab_update_conjugate_1.cl"
-                           );
+		this->InitSimulationVariable("CG_OMEGA", this->SolverScalarDataType(), false);
+		this->InitSimulationBuffer("CONJUGATE_0", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("CONJUGATE_1", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("TMP_0", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("TMP_1", this->SolverScalarDataType(), this->deviceParticleCount);
+		if(preconditioner != NoPreconditioner)
+		{
+			this->InitSimulationBuffer("PRECONDITIONED_0", this->SolverScalarDataType(), this->deviceParticleCount);
+			this->InitSimulationBuffer("PRECONDITIONED_1", this->SolverScalarDataType(), this->deviceParticleCount);
+		}
+		else
+		{
+			program->ConnectSemantic("PRECONDITIONED_0", program->Buffer("CONJUGATE_0"));
+			program->ConnectSemantic("PRECONDITIONED_1", program->Buffer("CONJUGATE_1"));
+		}
+		if(deviceSolverScalars)
+		{
+         this->LoadSubprogram("update result and residual",
+                              #include "isph/bicgstab_update_result_device.cl"
+                              );
+         this->LoadSubprogram("update conjugate 0",
+                              #include "isph/bicgstab_update_conjugate_0_device.cl"
+                              );
+         this->LoadSubprogram("update conjugate 1",
+                              #include "isph/bicgstab_update_conjugate_1_device.cl"
+                              );
+		}
+		else
+		{
+         this->LoadSubprogram("update result and residual",
+                              #include "isph/bicgstab_update_result.cl"
+                              );
+         this->LoadSubprogram("update conjugate 0",
+                              #include "isph/bicgstab_update_conjugate_0.cl"
+                              );
+         this->LoadSubprogram("update conjugate 1",
+                              #include "isph/bicgstab_update_conjugate_1.cl"
+                              );
+		}
 		program->ConnectSemantic("TMP", program->Buffer("TMP_0"));
 		program->ConnectSemantic("CONJUGATE", program->Buffer("CONJUGATE_0"));
 		program->ConnectSemantic("DOT_1", program->Buffer("TMP_0"));
 		program->ConnectSemantic("DOT_2", program->Buffer("CONJUGATE_0"));
 	}
+	else if(solverType == PipelinedCG)
+	{
+		this->InitSimulationBuffer("PCG_W", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("PCG_Q", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("PCG_Z", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("PCG_S", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("PCG_P", this->SolverScalarDataType(), this->deviceParticleCount);
+		this->InitSimulationBuffer("DOT_PAIR_OUT", SolverScalarDataType(), 2 * program->Buffer("DOT_OUT")->Elements());
+		CLLocalBuffer *pairVar = new CLLocalBuffer(program, "LOCAL_DOT_PAIR");  pairVar->SetSpace(SolverScalarDataType(), 2 * 256);
+      this->LoadSubprogram("dot product pair",
+                           #include "isph/dot_pair.cl"
+                           );
+      this->LoadSubprogram("finish pipelined dot products",
+                           #include "isph/pipelined_cg_scalars.cl"
+                           );
+      this->LoadSubprogram("update pipelined cg",
+                           #include "isph/pipelined_cg_update.cl"
+                           );
+		program->ConnectSemantic("TMP", program->Buffer("PCG_Q"));
+		program->ConnectSemantic("CONJUGATE", program->Buffer("PCG_W"));
+		program->ConnectSemantic("DOT_1", program->Buffer("RESIDUAL"));
+		program->ConnectSemantic("DOT_2", program->Buffer("PCG_W"));
+	}
 
 	program->ConnectSemantic("DUMMY_SCALAR", program->Buffer("PRESSURES"));
 	program->ConnectSemantic("DUMMY_VECTOR", program->Buffer("VELOCITIES"));
 
+	// attributes that neighbor loops read in cell order
+	this->InitSortedBuffer("VOLUMES");
+	this->InitSortedBuffer("VELOCITIES");
+	this->InitSortedBuffer("PRESSURES");
+	this->InitSortedBuffer("CONJUGATE");
+
+	// solver helpers are enqueued many times per time step, don't look them up by name
+	matrixVectorSubprogram = this->Subprogram(assembledMatrix ? "sparse matrix-vector product" : "matrix-vector product");
+	dotSubprogram = this->Subprogram("dot product");
+	finishDotSubprogram = this->Subprogram("finish dot product");
+	dotPairSubprogram = this->Subprogram("dot product pair");
+	jacobiSubprogram = this->Subprogram("jacobi preconditioner");
+	dummyScalarSubprogram = this->Subprogram("dummy scalar copy");
+	dummySolverScalarSubprogram = this->Subprogram("dummy solver scalar copy");
+
 	return true;
 }
 
@@ -163,6 +418,17 @@ bool IsphSimulation::PostInitSph()
 			return false;
 	}
 
+	if(assembledMatrix)
+		program->Buffer("PPE_ROW_OVERFLOW")->SetScalar(0.0);
+
+	// pair-wise kernel adds to sums, that corrector step clears after reading
+	if(pairwisePressureGradient || this->TiledKernels())
+	{
+		CLGlobalBuffer* gradP = program->Buffer("PRESSURE_GRADIENTS");
+		for(unsigned int i=0; i<gradP->Elements(); i++)
+			gradP->SetVector(i, Vec<3,double>(0.0));
+	}
+
 	return true;
 }
 
@@ -172,13 +438,14 @@ bool IsphSimulation::RunSph()
 	if(!this->RunGrid())
 		return false;
 	*/
+	// old values are rotated instead of copied where next kernel overwrites them
 	if(projectionOrder > 1)
 	{
-		if(!program->Buffer("VELOCITIES_OLDER")->CopyFrom(program->Buffer("VELOCITIES_OLD"), false))
+		if(!program->SwapBuffers("VELOCITIES_OLDER", "VELOCITIES_OLD"))
 			return false;
 	}
 
-	if(!program->Buffer("POSITIONS_OLD")->CopyFrom(program->Buffer("POSITIONS"), false))
+	if(!program->SwapBuffers("POSITIONS_OLD", "POSITIONS"))
 		return false;
 
 	if(!program->Buffer("VELOCITIES_OLD")->CopyFrom(program->Buffer("VELOCITIES"), false))
@@ -187,61 +454,80 @@ bool IsphSimulation::RunSph()
 	if(!this->EnqueueSubprogram("temp positions"))
 		return false;
 
-	if(!program->Buffer("POSITIONS_TEMP")->CopyFrom(program->Buffer("POSITIONS"), false))
-		return false;
-
 	if(!this->RunGrid())
 		return false;
 
 	if(!this->EnqueueSubprogram("calc volumes"))
 		return false;
 
+	if(!this->ReorderBuffer("VOLUMES"))
+		return false;
+
 	if(projectionForm != NonIncremental)
 	{
-		if(!program->Buffer("PRESSURES_OLD")->CopyFrom(program->Buffer("PRESSURES"), false))
+		// without warm start, build rhs kernel clears all pressures
+		if(warmStart)
+		{
+			if(!program->Buffer("PRESSURES_OLD")->CopyFrom(program->Buffer("PRESSURES"), false))
+				return false;
+		}
+		else if(!program->SwapBuffers("PRESSURES_OLD", "PRESSURES"))
 			return false;
 	}
 
-	if(SmoothingKernelCorrection())
+	// with kernel correction, temp velocities kernel computes it too
+	if(!this->EnqueueSubprogram("temp velocities"))
+		return false;
+
+	if(!this->ReorderBuffer("VELOCITIES"))
+		return false;
+
+	if(!this->EnqueueSubprogram("build rhs"))
+		return false;
+
+	if(assembledMatrix)
 	{
-		if(!this->EnqueueSubprogram("kernel correction"))
+		if(!this->EnqueueSubprogram("assemble matrix"))
 			return false;
 	}
 
-	if(!this->EnqueueSubprogram("temp velocities"))
+	// solver decides on host from data it reads back, so replay solves from host again
+	if(!program->RunHostCommand(SolvePressureCommand, this))
 		return false;
 
-	if(!this->EnqueueSubprogram("build rhs"))
+	if(!this->ReorderBuffer("PRESSURES"))
 		return false;
 
-	if(solverType == CG)
+	if(pairwisePressureGradient)
 	{
-		if(!SolvePressureWithCG())
+		if(!this->EnqueueSubprogram("pressure gradient pairs"))
 			return false;
 	}
-	else if(solverType == BiCGSTAB)
+	else if(this->TiledKernels())
 	{
-		if(!SolvePressureWithBiCGSTAB())
+		if(!this->EnqueueTiledSubprogram(this->Subprogram("pressure gradient tiled")))
 			return false;
 	}
-	else return false;
 
 	if(!this->EnqueueSubprogram("corrector step"))
 		return false;
 
-	if(shifting && (this->TimeStepCount() + 1) % shiftingFrequency == 0)
+	if(!program->SwapBuffers("POSITIONS_TEMP", "POSITIONS"))
+		return false;
+
+	if(StepVariant())
 	{
 		if(!this->RunGrid())
 			return false;
-		if(!program->Buffer("PRESSURES_TEMP")->CopyFrom(program->Buffer("PRESSURES"), false))
+		if(!this->EnqueueSubprogram("shift particles"))
 			return false;
-		if(!program->Buffer("VELOCITIES_TEMP")->CopyFrom(program->Buffer("VELOCITIES"), false))
+		if(!this->EnqueueSubprogram("update shifted particles"))
 			return false;
-		if(!program->Buffer("POSITIONS_TEMP")->CopyFrom(program->Buffer("POSITIONS"), false))
+		if(!program->SwapBuffers("PRESSURES_TEMP", "PRESSURES"))
 			return false;
-		if(!this->EnqueueSubprogram("shift particles"))
+		if(!program->SwapBuffers("VELOCITIES_TEMP", "VELOCITIES"))
 			return false;
-		if(!this->EnqueueSubprogram("update shifted particles"))
+		if(!program->SwapBuffers("POSITIONS_TEMP", "POSITIONS"))
 			return false;
 	}
 
@@ -254,6 +540,12 @@ bool IsphSimulation::RunSph()
 	return true;
 }
 
+unsigned int IsphSimulation::StepVariant()
+{
+	// particles are shifted every few steps
+	return shifting && (this->TimeStepCount() + 1) % shiftingFrequency == 0;
+}
+
 double IsphSimulation::SuggestTimeStep()
 {
 	double dt_cfl = this->timeStepCount ? 0.2 * this->particleSpacing / this->MaximumVelocity() : 1e-6;
@@ -261,6 +553,19 @@ double IsphSimulation::SuggestTimeStep()
 	return (std::min)((std::min)(dt_cfl, dt_visc), 1e-3);
 }
 
+bool IsphSimulation::EnqueueTimeStep(bool automatic)
+{
+	// same conditions as SuggestTimeStep(), without reading maximum velocity back
+	if(automatic)
+	{
+		int localSize = this->Devices()->Device(0)->IsCPU() ? 1 : 256;
+		if(!this->EnqueueSubprogram("max velocity", localSize * program->Buffer("OUT_MAX_VELOCITIES")->Elements(), localSize))
+			return false;
+	}
+
+	return Simulation::EnqueueTimeStep(automatic);
+}
+
 void IsphSimulation::SetSolver( SolverType type )
 {
 	solverType = type;
@@ -271,78 +576,231 @@ void IsphSimulation::SetMaxSolverIterations( unsigned int iterations )
 	maxIterations = iterations;
 }
 
+void IsphSimulation::SetMaxRefinements( unsigned int refinements )
+{
+	maxRefinements = refinements;
+}
+
 void IsphSimulation::SetSolverTolerance( double tolerance )
 {
 	solvingTolerance = tolerance;
 }
 
+void IsphSimulation::SetAssembledMatrix( bool enable )
+{
+	assembledMatrix = enable;
+}
+
+void IsphSimulation::SetDeviceSolverScalars( bool enable, unsigned int checkInterval )
+{
+	deviceSolverScalars = enable;
+
+	if(checkInterval < 1)
+	{
+		Log::Send(Log::Warning, "Solver convergence check interval cannot be less than 1. Setting to 1.");
+		solverCheckInterval = 1;
+	}
+	else
+		solverCheckInterval = checkInterval;
+}
+
+void IsphSimulation::SetPreconditioner( PreconditionerType type )
+{
+	preconditioner = type;
+}
+
+void IsphSimulation::SetWarmStart( bool enable )
+{
+	warmStart = enable;
+}
+
 void IsphSimulation::SetFreeSurfaceFactor( double value )
 {
 	freeSurfaceFactor = value;
 }
 
+bool IsphSimulation::SolvePressureCommand(void* simulation)
+{
+	return ((IsphSimulation*)simulation)->SolvePressure();
+}
+
+bool IsphSimulation::SolvePressure()
+{
+	if(preconditioner == MultigridPreconditioner)
+	{
+		if(!AssembleMultigrid())
+			return false;
+	}
+
+	bool solved = MixedPrecision() ? SolvePressureWithRefinement() : SolvePressureSystem();
+
+	// solver has waited for the assembled matrix by now, so reading its overflow costs little
+	if(assembledMatrix)
+	{
+		CLGlobalBuffer* overflow = program->Buffer("PPE_ROW_OVERFLOW");
+		if(!overflow->Download(true, true))
+			return false;
+		unsigned int rowLength = static_cast<unsigned int>(overflow->GetScalar());
+		if(rowLength)
+		{
+			Log::Send(Log::Error, "PPE matrix row has " + Utils::IntegerString(rowLength) + " entries, more than assembled matrix can hold ("
+				+ Utils::IntegerString(this->NeighborCapacity(this->supportRadius)) + "). Disable matrix assembly for this simulation.");
+			return false;
+		}
+	}
+
+	return solved;
+}
+
+bool IsphSimulation::SolvePressureWithRefinement()
+{
+	CLGlobalBuffer* pressures = program->Buffer("PRESSURES");
+	CLGlobalBuffer* solverRhs = program->Buffer("SOLVER_RHS");
+	CLKernelArgument* subtractProduct = program->Argument("SUBTRACT_PRODUCT");
+
+	// rounded right hand side is accurate enough for its norm
+	subtractProduct->SetScalar(0);
+	if(!this->EnqueueSubprogram("refinement residual"))
+		return false;
+
+	double norm_rhs_squared = dot(solverRhs, solverRhs);
+	double residual_norm_squared = norm_rhs_squared;
+
+	if(abs(norm_rhs_squared) <= DBL_EPSILON)
+	{
+		Log::Send(Log::Error, "Poisson equation has null vector right hand side.");
+		return false;
+	}
+
+	unsigned int i = 0;
+	subtractProduct->SetScalar(1);
+	while(true)
+	{
+		// without warm start pressure is zero, so initial residual is right hand side itself
+		if(i || warmStart)
+		{
+			if(!CopyToDummies(pressures))
+				return false;
+			if(!this->ReorderBuffer("PRESSURES"))
+				return false;
+			if(!this->EnqueueSubprogram("refinement residual"))
+				return false;
+			residual_norm_squared = dot(solverRhs, solverRhs);
+		}
+
+		if(abs(residual_norm_squared / norm_rhs_squared) <= solvingTolerance * solvingTolerance || i == maxRefinements)
+			break;
+
+		if(!SolvePressureSystem())
+			return false;
+
+		if(!this->EnqueueSubprogram("refinement update"))
+			return false;
+
+		i++;
+	}
+
+	if(!CopyToDummies(pressures))
+		return false;
+
+	double errorPrecision = sqrt(abs(residual_norm_squared / norm_rhs_squared));
+
+	if(errorPrecision > solvingTolerance)
+		Log::Send(Log::Warning, "Mixed precision refinement hasn't converged to specified error tolerance in " + Utils::IntegerString(i) + " refinements. Increase maximum refinements.");
+	else
+		LogDebug("Mixed precision refinement solved pressure with " + Utils::IntegerString(i) + " refinements, and error of " + Utils::DoubleString(errorPrecision));
+
+	return true;
+}
+
+bool IsphSimulation::SolvePressureSystem()
+{
+	if(solverType == CG)
+		return deviceSolverScalars ? SolvePressureWithCGOnDevice() : SolvePressureWithCG();
+	if(solverType == BiCGSTAB)
+		return deviceSolverScalars ? SolvePressureWithBiCGSTABOnDevice() : SolvePressureWithBiCGSTAB();
+	if(solverType == PipelinedCG)
+		return SolvePressureWithPipelinedCG();
+	return false;
+}
+
 bool IsphSimulation::SolvePressureWithCG()
 {
-	CLGlobalBuffer* rhs = program->Buffer("RHS");
+	double tolerance = KrylovTolerance();
+	CLGlobalBuffer* rhs = program->Buffer("SOLVER_RHS");
 	CLGlobalBuffer* residual = program->Buffer("RESIDUAL");
 	CLGlobalBuffer* conjugate = program->Buffer("CONJUGATE");
 	CLGlobalBuffer* tmp = program->Buffer("TMP");
+	CLGlobalBuffer* precond = program->Buffer("PRECONDITIONED");
 
-	residual->CopyFrom(rhs); // ok if initial solution is {0}, else residual = rhs - A.x0
-	conjugate->CopyFrom(residual); // todo do this already in build rhs kernel
+	if(!InitialResidual(tmp))
+		return false;
+	if(!ApplyPreconditioner(residual, precond))
+		return false;
+	conjugate->CopyFrom(precond); // todo do this already in build rhs kernel
 
 	unsigned int i;
-	double ip_rr = dot(residual, residual);
+	double residual_norm_squared = dot(residual, residual);
+	double norm_rhs_squared = KrylovWarmStart() ? dot(rhs, rhs) : residual_norm_squared;
 
-	if(abs(ip_rr) <= DBL_EPSILON)
+	if(abs(norm_rhs_squared) <= DBL_EPSILON)
 	{
 		Log::Send(Log::Error, "Poisson equation has null vector right hand side.");
 		return false;
 	}
 
-	double norm_rhs_squared = ip_rr;
-	double residual_norm_squared;
+	double ip_rr = preconditioner != NoPreconditioner ? dot(residual, precond) : residual_norm_squared;
 
 	CLKernelArgument* alpha = program->Argument("CG_ALPHA");
 	CLKernelArgument* beta = program->Argument("CG_BETA");
+	CLSubProgram* updateResult = this->Subprogram("update result and residual");
+	CLSubProgram* updateConjugate = this->Subprogram("update conjugate");
 
-	program->ConnectSemantic("DUMMY_SCALAR", program->Buffer("CONJUGATE"));
-
-	for(i = 0; i < maxIterations; i++)
+	// initial guess can already be good enough
+	for(i = 0; i < maxIterations && abs(residual_norm_squared / norm_rhs_squared) > tolerance * tolerance; i++)
 	{
-		if(!this->EnqueueSubprogram("dummy scalar copy"))
+		if(!CopyToDummies(conjugate))
+			return false;
+
+		if(!this->ReorderBuffer("CONJUGATE"))
 			return false;
 
-		if(!this->EnqueueSubprogram("matrix-vector product"))
+		if(!this->EnqueueMatrixVectorProduct())
 			return false;
 
 		double inner_prod_temp = dot(tmp, conjugate);
 		alpha->SetScalar(ip_rr / inner_prod_temp);
 
-		if(!this->EnqueueSubprogram("update result and residual"))
+		if(!this->EnqueueSubprogram(updateResult))
 			return false;
 
 		residual_norm_squared = dot(residual, residual);
 
-		if(abs(residual_norm_squared / norm_rhs_squared) <= solvingTolerance * solvingTolerance)
+		if(abs(residual_norm_squared / norm_rhs_squared) <= tolerance * tolerance)
 			break;
 
 		// todo lower stuff put at start loop if(i>0)
-		beta->SetScalar(residual_norm_squared / ip_rr);
-		ip_rr = residual_norm_squared;
+		double new_ip_rr = residual_norm_squared;
+		if(preconditioner != NoPreconditioner)
+		{
+			if(!ApplyPreconditioner(residual, precond))
+				return false;
+			new_ip_rr = dot(residual, precond);
+		}
+		beta->SetScalar(new_ip_rr / ip_rr);
+		ip_rr = new_ip_rr;
 
-		if(!this->EnqueueSubprogram("update conjugate"))
+		if(!this->EnqueueSubprogram(updateConjugate))
 			return false;
 
 	}
 
-	program->ConnectSemantic("DUMMY_SCALAR", program->Buffer("PRESSURES"));
-	if(!this->EnqueueSubprogram("dummy scalar copy"))
+	if(!CopyToDummies(program->Buffer("SOLUTION")))
 		return false;
 
 	double errorPrecision = sqrt(abs(residual_norm_squared / norm_rhs_squared));
 
-	if(errorPrecision > solvingTolerance)
+	if(errorPrecision > tolerance)
 		Log::Send(Log::Warning, "CG solver hasn't converged to specified error tolerance. Increase maximum iterations or try BiCGSTAB solver.");
 	else
 		LogDebug("CG solver solved pressure with " + Utils::IntegerString(i) + " iterations, and error of " + Utils::DoubleString(errorPrecision));
@@ -352,83 +810,83 @@ bool IsphSimulation::SolvePressureWithCG()
 
 bool IsphSimulation::SolvePressureWithBiCGSTAB()
 {
-	CLGlobalBuffer* rhs = program->Buffer("RHS");
+	double tolerance = KrylovTolerance();
+	CLGlobalBuffer* rhs = program->Buffer("SOLVER_RHS");
 	CLGlobalBuffer* residual = program->Buffer("RESIDUAL");
 	CLGlobalBuffer* conjugate0 = program->Buffer("CONJUGATE_0");
 	CLGlobalBuffer* conjugate1 = program->Buffer("CONJUGATE_1");
 	CLGlobalBuffer* tmp0 = program->Buffer("TMP_0");
 	CLGlobalBuffer* tmp1 = program->Buffer("TMP_1");
+	CLGlobalBuffer* precond0 = program->Buffer("PRECONDITIONED_0");
+	CLGlobalBuffer* precond1 = program->Buffer("PRECONDITIONED_1");
 
-	residual->CopyFrom(rhs); // ok if initial solution is {0}, else residual = rhs - A.x0
+	if(!InitialResidual(tmp0))
+		return false;
 	conjugate0->CopyFrom(residual); // todo do this already in build rhs kernel
 
-	double ip_rr = dot(residual, residual);
+	double residual_norm_squared = dot(residual, residual);
+	double norm_rhs_squared = KrylovWarmStart() ? dot(rhs, rhs) : residual_norm_squared;
 
-	if(abs(ip_rr) <= DBL_EPSILON)
+	if(abs(norm_rhs_squared) <= DBL_EPSILON)
 	{
 		//Log::Send(Log::Error, "Poisson equation has null vector right hand side.");
 		return true;
 	}
 
-	double norm_rhs_squared = ip_rr;
-	double residual_norm_squared;
+	// RHS is the shadow residual
+	double ip_rr = KrylovWarmStart() ? dot(residual, rhs) : residual_norm_squared;
 
 	CLKernelArgument* alpha = program->Argument("CG_ALPHA");
 	CLKernelArgument* beta = program->Argument("CG_BETA");
 	CLKernelArgument* omega = program->Argument("CG_OMEGA");
+	CLSubProgram* updateResult = this->Subprogram("update result and residual");
+	CLSubProgram* updateConjugate0 = this->Subprogram("update conjugate 0");
+	CLSubProgram* updateConjugate1 = this->Subprogram("update conjugate 1");
 
+	// initial guess can already be good enough
 	unsigned int i;
-	for(i = 0; i < maxIterations; i++)
+	for(i = 0; i < maxIterations && abs(residual_norm_squared / norm_rhs_squared) > tolerance * tolerance; i++)
 	{
-		program->ConnectSemantic("DUMMY_SCALAR", conjugate0);
-		if(!this->EnqueueSubprogram("dummy scalar copy"))
+		if(!ApplyPreconditioner(conjugate0, precond0))
 			return false;
-
-		program->ConnectSemantic("TMP", tmp0, false);
-		program->ConnectSemantic("CONJUGATE", conjugate0);
-		if(!this->EnqueueSubprogram("matrix-vector product", Utils::NearestMultiple(this->ParticleCount(), 256), 256))
+		if(!MatrixVectorProduct(precond0, tmp0))
 			return false;
 
 		alpha->SetScalar(ip_rr / dot(tmp0, rhs));
 
-		if(!this->EnqueueSubprogram("update conjugate 1"))
+		if(!this->EnqueueSubprogram(updateConjugate1))
 			return false;
 
-		program->ConnectSemantic("DUMMY_SCALAR", conjugate1);
-		if(!this->EnqueueSubprogram("dummy scalar copy"))
+		if(!ApplyPreconditioner(conjugate1, precond1))
 			return false;
-
-		program->ConnectSemantic("TMP", tmp1, false);
-		program->ConnectSemantic("CONJUGATE", conjugate1);
-		if(!this->EnqueueSubprogram("matrix-vector product", Utils::NearestMultiple(this->ParticleCount(), 256), 256))
+		if(!MatrixVectorProduct(precond1, tmp1))
 			return false;
 
 		omega->SetScalar(dot(tmp1, conjugate1) / dot(tmp1, tmp1));
 
-		if(!this->EnqueueSubprogram("update result and residual"))
+		if(!this->EnqueueSubprogram(updateResult))
 			return false;
 
 		residual_norm_squared = dot(residual, residual);
 
-		if(abs(residual_norm_squared / norm_rhs_squared) <= solvingTolerance * solvingTolerance)
+		if(abs(residual_norm_squared / norm_rhs_squared) <= tolerance * tolerance)
 			break;
 
 		double new_ip_rr = dot(residual, rhs);
 		beta->SetScalar((new_ip_rr / ip_rr) * (alpha->GetScalar() / omega->GetScalar()));
 		ip_rr = new_ip_rr;
 
-		if(!this->EnqueueSubprogram("update conjugate 0"))
+		if(!this->EnqueueSubprogram(updateConjugate0))
 			return false;
 
 	}
 
-	program->ConnectSemantic("DUMMY_SCALAR", program->Buffer("PRESSURES"));
-	if(!this->EnqueueSubprogram("dummy scalar copy"))
+	if(!CopyToDummies(program->Buffer("SOLUTION")))
 		return false;
 
 	double errorPrecision = sqrt(abs(residual_norm_squared / norm_rhs_squared));
 
-	if(errorPrecision > solvingTolerance)
+	if(errorPrecision > tolerance)
 		Log::Send(Log::Warning, "BiCGSTAB solver hasn't converged to specified error tolerance. Increase maximum iterations.");
 	else
 		LogDebug("BiCGSTAB solver solved pressure with " + Utils::IntegerString(i) + " iterations, and error of " + Utils::DoubleString(errorPrecision));
@@ -436,26 +894,580 @@ bool IsphSimulation::SolvePressureWithBiCGSTAB()
 	return true;
 }
 
-double IsphSimulation::dot( CLGlobalBuffer* a, CLGlobalBuffer* b )
+bool IsphSimulation::SolvePressureWithCGOnDevice()
 {
-	program->ConnectSemantic("DOT_1", a);
-	program->ConnectSemantic("DOT_2", b);
-	CLGlobalBuffer* out = program->Buffer("DOT_OUT");
-	
-	// enqueue reduction kernel and get the result
-	int localSize = Devices()->Device(0)->IsCPU() ? 1 : 256;
-	if(!this->EnqueueSubprogram("dot product", localSize * out->Elements(), localSize))
-		return 0.0;
-	if(!out->Download(false, true))
-		return 0.0;
-	program->Finish();
+	double tolerance = KrylovTolerance();
+	CLGlobalBuffer* rhs = program->Buffer("SOLVER_RHS");
+	CLGlobalBuffer* residual = program->Buffer("RESIDUAL");
+	CLGlobalBuffer* conjugate = program->Buffer("CONJUGATE");
+	CLGlobalBuffer* tmp = program->Buffer("TMP");
+	CLGlobalBuffer* precond = program->Buffer("PRECONDITIONED");
+	CLGlobalBuffer* scalars = program->Buffer("KRYLOV_SCALARS");
+	CLSubProgram* updateResult = this->Subprogram("update result and residual");
+	CLSubProgram* updateConjugate = this->Subprogram("update conjugate");
 
-	// accumulate downloaded data
-	double sum = 0.0;
-   for(size_t i=0; i < out->Elements(); i++)
-		sum += out->GetScalar(i);
+	if(!InitialResidual(tmp))
+		return false;
+	if(!ApplyPreconditioner(residual, precond))
+		return false;
+	conjugate->CopyFrom(precond);
 
-	return sum;
+	if(!dotOnDevice(residual, residual, KrylovInit))
+		return false;
+	if(KrylovWarmStart() && !dotOnDevice(rhs, rhs, KrylovSetReference))
+		return false;
+	if(preconditioner != NoPreconditioner)
+	{
+		// only sets (r,z) as the current inner product, beta is computed again before it's used
+		if(!dotOnDevice(residual, precond, KrylovComputePreconditionedBeta))
+			return false;
+	}
+	if(!scalars->Download(true, true))
+		return false;
+
+	if(abs(scalars->GetScalar(KrylovRR0)) <= DBL_EPSILON)
+	{
+		Log::Send(Log::Error, "Poisson equation has null vector right hand side.");
+		return false;
+	}
+
+	// iterations are only enqueued, host reads scalars every few iterations to check convergence
+	unsigned int i;
+	bool converged = scalars->GetScalar(KrylovDone) != 0.0;
+	for(i = 0; i < maxIterations && !converged; i++)
+	{
+		if(!CopyToDummies(conjugate))
+			return false;
+
+		if(!this->ReorderBuffer("CONJUGATE"))
+			return false;
+
+		if(!this->EnqueueMatrixVectorProduct())
+			return false;
+
+		if(!dotOnDevice(tmp, conjugate, KrylovComputeAlpha))
+			return false;
+
+		if(!this->EnqueueSubprogram(updateResult))
+			return false;
+
+		if(preconditioner != NoPreconditioner)
+		{
+			if(!dotOnDevice(residual, residual, KrylovCheckResidual))
+				return false;
+			if(!ApplyPreconditioner(residual, precond))
+				return false;
+			if(!dotOnDevice(residual, precond, KrylovComputePreconditionedBeta))
+				return false;
+		}
+		else if(!dotOnDevice(residual, residual, KrylovComputeCGBeta))
+			return false;
+
+		if(!this->EnqueueSubprogram(updateConjugate))
+			return false;
+
+		if((i + 1) % solverCheckInterval == 0)
+		{
+			if(!scalars->Download(true, true))
+				return false;
+			converged = scalars->GetScalar(KrylovDone) != 0.0;
+		}
+	}
+
+	if(!scalars->Download(true, true))
+		return false;
+
+	if(!CopyToDummies(program->Buffer("SOLUTION")))
+		return false;
+
+	double errorPrecision = sqrt(abs(scalars->GetScalar(KrylovResidual) / scalars->GetScalar(KrylovRR0)));
+
+	if(errorPrecision > tolerance)
+		Log::Send(Log::Warning, "CG solver hasn't converged to specified error tolerance. Increase maximum iterations or try BiCGSTAB solver.");
+	else
+		LogDebug("CG solver solved pressure within " + Utils::IntegerString(i) + " iterations, and error of " + Utils::DoubleString(errorPrecision));
+
+	return true;
+}
+
+bool IsphSimulation::SolvePressureWithBiCGSTABOnDevice()
+{
+	double tolerance = KrylovTolerance();
+	CLGlobalBuffer* rhs = program->Buffer("SOLVER_RHS");
+	CLGlobalBuffer* residual = program->Buffer("RESIDUAL");
+	CLGlobalBuffer* conjugate0 = program->Buffer("CONJUGATE_0");
+	CLGlobalBuffer* conjugate1 = program->Buffer("CONJUGATE_1");
+	CLGlobalBuffer* tmp0 = program->Buffer("TMP_0");
+	CLGlobalBuffer* tmp1 = program->Buffer("TMP_1");
+	CLGlobalBuffer* precond0 = program->Buffer("PRECONDITIONED_0");
+	CLGlobalBuffer* precond1 = program->Buffer("PRECONDITIONED_1");
+	CLGlobalBuffer* scalars = program->Buffer("KRYLOV_SCALARS");
+	CLSubProgram* updateResult = this->Subprogram("update result and residual");
+	CLSubProgram* updateConjugate0 = this->Subprogram("update conjugate 0");
+	CLSubProgram* updateConjugate1 = this->Subprogram("update conjugate 1");
+
+	if(!InitialResidual(tmp0))
+		return false;
+	conjugate0->CopyFrom(residual);
+
+	if(!dotOnDevice(residual, residual, KrylovInit))
+		return false;
+	if(KrylovWarmStart())
+	{
+		if(!dotOnDevice(rhs, rhs, KrylovSetReference))
+			return false;
+		// RHS is the shadow residual, only sets (r,rhs) as the current inner product
+		if(!dotOnDevice(residual, rhs, KrylovComputePreconditionedBeta))
+			return false;
+	}
+	if(!scalars->Download(true, true))
+		return false;
+
+	if(abs(scalars->GetScalar(KrylovRR0)) <= DBL_EPSILON)
+	{
+		//Log::Send(Log::Error, "Poisson equation has null vector right hand side.");
+		return true;
+	}
+
+	// iterations are only enqueued, host reads scalars every few iterations to check convergence
+	unsigned int i;
+	bool converged = scalars->GetScalar(KrylovDone) != 0.0;
+	for(i = 0; i < maxIterations && !converged; i++)
+	{
+		if(!ApplyPreconditioner(conjugate0, precond0))
+			return false;
+		if(!MatrixVectorProduct(precond0, tmp0))
+			return false;
+
+		if(!dotOnDevice(tmp0, rhs, KrylovComputeAlpha))
+			return false;
+
+		if(!this->EnqueueSubprogram(updateConjugate1))
+			return false;
+
+		if(!ApplyPreconditioner(conjugate1, precond1))
+			return false;
+		if(!MatrixVectorProduct(precond1, tmp1))
+			return false;
+
+		if(!dotOnDevice(tmp1, conjugate1, KrylovStore))
+			return false;
+		if(!dotOnDevice(tmp1, tmp1, KrylovComputeOmega))
+			return false;
+
+		if(!this->EnqueueSubprogram(updateResult))
+			return false;
+
+		if(!dotOnDevice(residual, residual, KrylovCheckResidual))
+			return false;
+
+		if(!dotOnDevice(residual, rhs, KrylovComputeBiCGSTABBeta))
+			return false;
+
+		if(!this->EnqueueSubprogram(updateConjugate0))
+			return false;
+
+		if((i + 1) % solverCheckInterval == 0)
+		{
+			if(!scalars->Download(true, true))
+				return false;
+			converged = scalars->GetScalar(KrylovDone) != 0.0;
+		}
+	}
+
+	if(!scalars->Download(true, true))
+		return false;
+
+	if(!CopyToDummies(program->Buffer("SOLUTION")))
+		return false;
+
+	double errorPrecision = sqrt(abs(scalars->GetScalar(KrylovResidual) / scalars->GetScalar(KrylovRR0)));
+
+	if(errorPrecision > tolerance)
+		Log::Send(Log::Warning, "BiCGSTAB solver hasn't converged to specified error tolerance. Increase maximum iterations.");
+	else
+		LogDebug("BiCGSTAB solver solved pressure within " + Utils::IntegerString(i) + " iterations, and error of " + Utils::DoubleString(errorPrecision));
+
+	return true;
+}
+
+bool IsphSimulation::SolvePressureWithPipelinedCG()
+{
+	double tolerance = KrylovTolerance();
+	CLGlobalBuffer* rhs = program->Buffer("SOLVER_RHS");
+	CLGlobalBuffer* residual = program->Buffer("RESIDUAL");
+	CLGlobalBuffer* w = program->Buffer("PCG_W");
+	CLGlobalBuffer* q = program->Buffer("PCG_Q");
+	CLGlobalBuffer* scalars = program->Buffer("KRYLOV_SCALARS");
+	CLKernelArgument* krylovOp = program->Argument("KRYLOV_OP");
+	CLSubProgram* finishDotProducts = this->Subprogram("finish pipelined dot products");
+	CLSubProgram* updatePipelinedCG = this->Subprogram("update pipelined cg");
+
+	// scalars are always on device, without device scalars option convergence is checked each iteration
+	unsigned int checkInterval = deviceSolverScalars ? solverCheckInterval : 1;
+
+	if(!InitialResidual(q))
+		return false;
+	if(!MatrixVectorProduct(residual, w))
+		return false;
+
+	unsigned int i;
+	bool converged = false;
+	for(i = 0; i < maxIterations && !converged; i++)
+	{
+		// single reduction for (r,r) and (w,r), followed by independent q = A.w
+		if(!EnqueueDotPair(residual, w))
+			return false;
+
+		if(!MatrixVectorProduct(w, q))
+			return false;
+
+		krylovOp->SetScalar(i ? KrylovComputeAlpha : KrylovInit);
+		if(!this->EnqueueSubprogram(finishDotProducts, 1, 1))
+			return false;
+
+		if(!i)
+		{
+			if(KrylovWarmStart() && !dotOnDevice(rhs, rhs, KrylovSetReference))
+				return false;
+			if(!scalars->Download(true, true))
+				return false;
+
+			if(abs(scalars->GetScalar(KrylovRR0)) <= DBL_EPSILON)
+			{
+				Log::Send(Log::Error, "Poisson equation has null vector right hand side.");
+				return false;
+			}
+		}
+
+		if(!this->EnqueueSubprogram(updatePipelinedCG))
+			return false;
+
+		if((i + 1) % checkInterval == 0)
+		{
+			if(!scalars->Download(true, true))
+				return false;
+			converged = scalars->GetScalar(KrylovDone) != 0.0;
+		}
+	}
+
+	if(!scalars->Download(true, true))
+		return false;
+
+	if(!CopyToDummies(program->Buffer("SOLUTION")))
+		return false;
+
+	double errorPrecision = sqrt(abs(scalars->GetScalar(KrylovResidual) / scalars->GetScalar(KrylovRR0)));
+
+	if(errorPrecision > tolerance)
+		Log::Send(Log::Warning, "Pipelined CG solver hasn't converged to specified error tolerance. Increase maximum iterations or try BiCGSTAB solver.");
+	else
+		LogDebug("Pipelined CG solver solved pressure within " + Utils::IntegerString(i) + " iterations, and error of " + Utils::DoubleString(errorPrecision));
+
+	return true;
+}
+
+bool IsphSimulation::InitialResidual( CLGlobalBuffer* product )
+{
+	CLGlobalBuffer* residual = program->Buffer("RESIDUAL");
+
+	if(!KrylovWarmStart())
+		return residual->CopyFrom(program->Buffer("SOLVER_RHS"));
+
+	// matrix-vector product reconnects semantics that solvers rely on
+	CLGlobalBuffer* conjugate = program->Buffer("CONJUGATE");
+	CLGlobalBuffer* tmp = program->Buffer("TMP");
+
+	if(!MatrixVectorProduct(program->Buffer("PRESSURES"), product))
+		return false;
+
+	program->ConnectSemantic("INITIAL_PRODUCT", product);
+	if(!this->EnqueueSubprogram("initial residual"))
+		return false;
+
+	program->ConnectSemantic("CONJUGATE", conjugate);
+	program->ConnectSemantic("TMP", tmp);
+
+	return true;
+}
+
+bool IsphSimulation::MatrixVectorProduct( CLGlobalBuffer* in, CLGlobalBuffer* out )
+{
+	if(!CopyToDummies(in))
+		return false;
+
+	program->ConnectSemantic("TMP", out, false);
+	program->ConnectSemantic("CONJUGATE", in);
+	if(!this->ReorderBuffer("CONJUGATE"))
+		return false;
+
+	return this->EnqueueMatrixVectorProduct(Utils::NearestMultiple(this->ParticleCount(), 256), 256);
+}
+
+bool IsphSimulation::ApplyPreconditioner( CLGlobalBuffer* in, CLGlobalBuffer* out )
+{
+	if(preconditioner == NoPreconditioner)
+		return true;
+
+	if(preconditioner == MultigridPreconditioner)
+		return ApplyMultigrid(in, out);
+
+	program->ConnectSemantic("PRECONDITIONER_IN", in);
+	program->ConnectSemantic("PRECONDITIONER_OUT", out);
+	return this->EnqueueSubprogram(jacobiSubprogram);
+}
+
+bool IsphSimulation::CopyToDummies( CLGlobalBuffer* buffer )
+{
+	if(buffer->DataType() != this->ScalarDataType())
+	{
+		program->ConnectSemantic("DUMMY_SOLVER_SCALAR", buffer);
+		return this->EnqueueSubprogram(dummySolverScalarSubprogram);
+	}
+
+	program->ConnectSemantic("DUMMY_SCALAR", buffer);
+	return this->EnqueueSubprogram(dummyScalarSubprogram);
+}
+
+bool IsphSimulation::InitMultigrid()
+{
+	// coarsen grid cells by 2 until the coarsest level is small enough to be smoothed directly
+	const unsigned int maxLevels = 16;
+	const unsigned int coarsestCells = 64;
+
+	Vec<3,int> counts(gridCellCount.x, gridCellCount.y, dimensions == 3 ? gridCellCount.z : 1);
+	std::string levelsSource = "__constant uint4 MG_LEVELS[] = {\n";
+	unsigned int offset = 0;
+
+	multigridCells.clear();
+	while(true)
+	{
+		unsigned int cells = counts.x * counts.y * counts.z;
+		levelsSource += "\t(uint4)(" + Utils::IntegerString(counts.x) + "," + Utils::IntegerString(counts.y) + "," + Utils::IntegerString(counts.z) + "," + Utils::IntegerString(offset) + "),\n";
+		multigridCells.push_back(cells);
+		offset += cells;
+
+		if(cells <= coarsestCells || multigridCells.size() >= maxLevels)
+			break;
+
+		counts.x = (counts.x + 1) / 2;
+		counts.y = (counts.y + 1) / 2;
+		if(dimensions == 3)
+			counts.z = (counts.z + 1) / 2;
+	}
+	levelsSource += "};\n";
+
+	LogDebug("Multigrid preconditioner with " + Utils::IntegerString(multigridCells.size()) + " grid levels");
+
+	unsigned int stencil = dimensions == 3 ? 27 : 9;
+	this->InitSimulationBuffer("MG_MATRIX", this->SolverScalarDataType(), stencil * offset);
+	this->InitSimulationBuffer("MG_X", this->SolverScalarDataType(), offset);
+	this->InitSimulationBuffer("MG_B", this->SolverScalarDataType(), offset);
+	this->InitSimulationBuffer("MG_R", this->SolverScalarDataType(), offset);
+	this->InitSimulationBuffer("MG_PARTICLE_CELLS", UintType, this->deviceParticleCount);
+	this->InitSimulationBuffer("MG_PARTICLE_AX", this->SolverScalarDataType(), this->deviceParticleCount);
+	this->InitSimulationVariable("MG_LEVEL", UintType, false);
+	this->InitSimulationVariable("MG_INIT", UintType, false);
+
+	this->LoadSubprogram("multigrid levels", levelsSource);
+   this->LoadSubprogram("multigrid utils",
+                        #include "isph/multigrid_utils.cl"
+                        );
+   this->LoadSubprogram("multigrid particle cells",
+                        #include "isph/multigrid_particle_cells.cl"
+                        );
+   this->LoadSubprogram("multigrid assemble cells",
+                        #include "isph/multigrid_assemble_cells.cl"
+                        );
+   this->LoadSubprogram("multigrid assemble coarse",
+                        #include "isph/multigrid_assemble_coarse.cl"
+                        );
+   this->LoadSubprogram("multigrid smooth particles",
+                        #include "isph/multigrid_particle_smooth.cl"
+                        );
+   this->LoadSubprogram("multigrid restrict particles",
+                        #include "isph/multigrid_particle_restrict.cl"
+                        );
+   this->LoadSubprogram("multigrid prolong particles",
+                        #include "isph/multigrid_particle_prolong.cl"
+                        );
+   this->LoadSubprogram("multigrid cell residual",
+                        #include "isph/multigrid_cell_residual.cl"
+                        );
+   this->LoadSubprogram("multigrid smooth cells",
+                        #include "isph/multigrid_cell_smooth.cl"
+                        );
+   this->LoadSubprogram("multigrid restrict cells",
+                        #include "isph/multigrid_cell_restrict.cl"
+                        );
+   this->LoadSubprogram("multigrid prolong cells",
+                        #include "isph/multigrid_cell_prolong.cl"
+                        );
+
+	return true;
+}
+
+bool IsphSimulation::AssembleMultigrid()
+{
+	if(!this->EnqueueSubprogram("multigrid particle cells", Utils::NearestMultiple(this->ParticleCount(), 256)))
+		return false;
+
+	if(!EnqueueMultigridLevel("multigrid assemble cells", 0))
+		return false;
+
+	for(unsigned int l = 1; l < multigridCells.size(); l++)
+	{
+		if(!EnqueueMultigridLevel("multigrid assemble coarse", l))
+			return false;
+	}
+
+	return true;
+}
+
+bool IsphSimulation::ApplyMultigrid( CLGlobalBuffer* in, CLGlobalBuffer* out )
+{
+	// damped Jacobi sweeps before and after coarse correction, same count keeps the cycle symmetric
+	const unsigned int particleSweeps = 1;
+	const unsigned int cellSweeps = 2;
+	const unsigned int coarsestSweeps = 16;
+
+	CLGlobalBuffer* ax = program->Buffer("MG_PARTICLE_AX");
+	size_t particlesSize = Utils::NearestMultiple(this->ParticleCount(), 256);
+	unsigned int levels = multigridCells.size();
+
+	// matrix-vector products below reconnect semantics that solvers rely on
+	CLGlobalBuffer* conjugate = program->Buffer("CONJUGATE");
+	CLGlobalBuffer* tmp = program->Buffer("TMP");
+
+	program->ConnectSemantic("PRECONDITIONER_IN", in);
+	program->ConnectSemantic("PRECONDITIONER_OUT", out);
+
+	// pre-smoothing on particles
+	for(unsigned int s = 0; s < particleSweeps; s++)
+	{
+		if(s && !MatrixVectorProduct(out, ax))
+			return false;
+		program->Argument("MG_INIT")->SetScalar(s ? 0 : 1);
+		if(!this->EnqueueSubprogram("multigrid smooth particles", particlesSize))
+			return false;
+	}
+
+	// restrict residual to grid cells
+	if(!MatrixVectorProduct(out, ax))
+		return false;
+	if(!EnqueueMultigridLevel("multigrid restrict particles", 0))
+		return false;
+
+	// down the grid levels
+	for(unsigned int l = 0; l < levels; l++)
+	{
+		unsigned int sweeps = (l == levels - 1) ? coarsestSweeps : cellSweeps;
+		for(unsigned int s = 0; s < sweeps; s++)
+		{
+			if(s && !EnqueueMultigridLevel("multigrid cell residual", l))
+				return false;
+			if(!EnqueueMultigridLevel("multigrid smooth cells", l, !s))
+				return false;
+		}
+
+		if(l < levels - 1)
+		{
+			if(!EnqueueMultigridLevel("multigrid cell residual", l))
+				return false;
+			if(!EnqueueMultigridLevel("multigrid restrict cells", l + 1))
+				return false;
+		}
+	}
+
+	// up the grid levels
+	for(int l = (int)levels - 2; l >= 0; l--)
+	{
+		if(!EnqueueMultigridLevel("multigrid prolong cells", l))
+			return false;
+		for(unsigned int s = 0; s < cellSweeps; s++)
+		{
+			if(!EnqueueMultigridLevel("multigrid cell residual", l))
+				return false;
+			if(!EnqueueMultigridLevel("multigrid smooth cells", l))
+				return false;
+		}
+	}
+
+	// correct particles and post-smooth
+	if(!this->EnqueueSubprogram("multigrid prolong particles", particlesSize))
+		return false;
+
+	for(unsigned int s = 0; s < particleSweeps; s++)
+	{
+		if(!MatrixVectorProduct(out, ax))
+			return false;
+		program->Argument("MG_INIT")->SetScalar(0);
+		if(!this->EnqueueSubprogram("multigrid smooth particles", particlesSize))
+			return false;
+	}
+
+	program->ConnectSemantic("CONJUGATE", conjugate);
+	program->ConnectSemantic("TMP", tmp);
+
+	return true;
+}
+
+bool IsphSimulation::EnqueueMultigridLevel( const std::string& name, unsigned int level, bool initialSweep )
+{
+	program->Argument("MG_LEVEL")->SetScalar(level);
+	program->Argument("MG_INIT")->SetScalar(initialSweep ? 1 : 0);
+	return this->EnqueueSubprogram(name, Utils::NearestMultiple(multigridCells[level], 64));
+}
+
+bool IsphSimulation::EnqueueMatrixVectorProduct( size_t globalSize, size_t localSize )
+{
+	if(this->TiledKernels() && !assembledMatrix)
+		return this->EnqueueTiledSubprogram(matrixVectorSubprogram);
+	return this->EnqueueSubprogram(matrixVectorSubprogram, globalSize, localSize);
+}
+
+double IsphSimulation::dot( CLGlobalBuffer* a, CLGlobalBuffer* b )
+{
+	program->ConnectSemantic("DOT_1", a);
+	program->ConnectSemantic("DOT_2", b);
+	CLGlobalBuffer* out = program->Buffer("DOT_OUT");
+	
+	// enqueue reduction kernel and get the result
+	int localSize = Devices()->Device(0)->IsCPU() ? 1 : 256;
+	if(!this->EnqueueSubprogram(dotSubprogram, localSize * out->Elements(), localSize))
+		return 0.0;
+	if(!out->Download(false, true))
+		return 0.0;
+	program->Finish();
+
+	// accumulate downloaded data
+	double sum = 0.0;
+   for(size_t i=0; i < out->Elements(); i++)
+		sum += out->GetScalar(i);
+
+	return sum;
+}
+
+bool IsphSimulation::dotOnDevice( CLGlobalBuffer* a, CLGlobalBuffer* b, KrylovOperation op )
+{
+	program->ConnectSemantic("DOT_1", a);
+	program->ConnectSemantic("DOT_2", b);
+	program->Argument("KRYLOV_OP")->SetScalar(op);
+
+	// partial sums stay on device and are finished by single work-item
+	int localSize = Devices()->Device(0)->IsCPU() ? 1 : 256;
+	if(!this->EnqueueSubprogram(dotSubprogram, localSize * program->Buffer("DOT_OUT")->Elements(), localSize))
+		return false;
+	return this->EnqueueSubprogram(finishDotSubprogram, 1, 1);
+}
+
+bool IsphSimulation::EnqueueDotPair( CLGlobalBuffer* a, CLGlobalBuffer* b )
+{
+	program->ConnectSemantic("DOT_1", a);
+	program->ConnectSemantic("DOT_2", b);
+
+	int localSize = Devices()->Device(0)->IsCPU() ? 1 : 256;
+	return this->EnqueueSubprogram(dotPairSubprogram, localSize * program->Buffer("DOT_OUT")->Elements(), localSize);
 }
 
 void IsphSimulation::SetProjection( ProjectionForm form, unsigned int order )
@@ -506,3 +1518,8 @@ void IsphSimulation::SetStrongDirichletBC( bool strong )
 {
 	strongDirichletBC = strong;
 }
+
+void IsphSimulation::SetPairwisePressureGradient( bool enable )
+{
+	pairwisePressureGradient = enable;
+}
@@ -1,6 +1,8 @@
 #ifndef ISPH_ISPHSIMULATION_H
 #define ISPH_ISPHSIMULATION_H
 
+#include <algorithm>
+#include <vector>
 #include "simulation.h"
 
 namespace isph {
@@ -26,7 +28,19 @@ namespace isph {
 	enum SolverType
 	{
 		CG,			//!< Conjugate gradient. Faster but not suitable for more complex cases.
-		BiCGSTAB	//!< Stabilized BiConjugate gradient. Slower but stable solver.
+		BiCGSTAB,	//!< Stabilized BiConjugate gradient. Slower but stable solver.
+		PipelinedCG	//!< Pipelined conjugate gradient with single reduction per iteration. Less synchronization than CG, but slightly less robust to round-off.
+	};
+
+	/*!
+	 *	\enum	PreconditionerType
+	 *	\brief	Preconditioners for iterative solving of pressure Poisson equation.
+	 */
+	enum PreconditionerType
+	{
+		NoPreconditioner,		//!< Solve unpreconditioned system.
+		JacobiPreconditioner,	//!< Scale by inverse of matrix diagonal. Cheap, reduces number of iterations when particle volumes vary.
+		MultigridPreconditioner	//!< Geometric multigrid V-cycle on uniform grid cells. Number of iterations doesn't grow with resolution. Needs assembled matrix.
 	};
 
 	/*!
@@ -91,6 +105,18 @@ namespace isph {
 		 */
 		inline unsigned int MaxSolverIterations() { return maxIterations; }
 
+		/*!
+		 *	\brief	Set maximum number of double precision refinements of mixed precision solver. Default is 10.
+		 *
+		 *	Each refinement runs single precision solver, with up to maximum number of solver iterations.
+		 */
+		void SetMaxRefinements(unsigned int refinements);
+
+		/*!
+		 *	\brief	Get maximum number of double precision refinements of mixed precision solver.
+		 */
+		inline unsigned int MaxRefinements() { return maxRefinements; }
+
 		/*!
 		 *	\brief	Set convergence criterion that satisfies solution. Default is 0.001.
 		 *
@@ -104,6 +130,66 @@ namespace isph {
 		 */
 		inline double SolverTolerance() { return solvingTolerance; }
 
+		/*!
+		 *	\brief	Set whether PPE matrix is assembled once per time step. Default is true.
+		 *
+		 *	Assembled matrix is stored in ELLPACK format, and solver iterations only do sparse matrix-vector products
+		 *	with stored coefficients. When disabled, coefficients are recomputed from neighbors in each iteration,
+		 *	which is slower but needs less memory.
+		 */
+		void SetAssembledMatrix(bool enable);
+
+		/*!
+		 *	\brief	Get whether PPE matrix is assembled once per time step.
+		 */
+		inline bool AssembledMatrix() { return assembledMatrix; }
+
+		/*!
+		 *	\brief	Set whether solver scalars are kept on device. Enabled by default.
+		 *	\param	enable	When enabled, dot products are finished on device and alpha, beta and omega stay in device memory,
+		 *					so solver iterations are enqueued without waiting for the host.
+		 *	\param	checkInterval	After how many iterations host reads the residual to check for convergence. Default is 5.
+		 */
+		void SetDeviceSolverScalars(bool enable, unsigned int checkInterval = 5);
+
+		/*!
+		 *	\brief	Get whether solver scalars are kept on device.
+		 */
+		inline bool DeviceSolverScalars() { return deviceSolverScalars; }
+
+		/*!
+		 *	\brief	Get after how many iterations host checks for convergence, when solver scalars are kept on device.
+		 */
+		inline unsigned int SolverCheckInterval() { return solverCheckInterval; }
+
+		/*!
+		 *	\brief	Set preconditioner for CG and BiCGSTAB solvers. None by default.
+		 *
+		 *	Jacobi preconditioner uses matrix diagonal, which is taken from assembled matrix,
+		 *	or computed while building RHS when matrix is not assembled.
+		 *	Multigrid preconditioner does one V-cycle with damped Jacobi smoothing, coarsening
+		 *	particles to grid cells and cells further by 2 in each direction.
+		 */
+		void SetPreconditioner(PreconditionerType type);
+
+		/*!
+		 *	\brief	Get preconditioner for CG and BiCGSTAB solvers.
+		 */
+		inline PreconditionerType Preconditioner() { return preconditioner; }
+
+		/*!
+		 *	\brief	Set whether pressure of previous time step is initial guess of solver. Disabled by default.
+		 *
+		 *	Pressure changes slowly between time steps, so solver needs less iterations, at cost of
+		 *	one more matrix-vector product for initial residual. Convergence is then measured relative to RHS norm.
+		 */
+		void SetWarmStart(bool enable);
+
+		/*!
+		 *	\brief	Get whether pressure of previous time step is initial guess of solver.
+		 */
+		inline bool WarmStart() { return warmStart; }
+
 		/*!
 		*	\brief	Set whether particle anti-clustering method should be used.
 		*	\param	enable	Choose whether to enable or disable the algorithm. It's disabled by default.
@@ -145,6 +231,21 @@ namespace isph {
 		 */
 		void SetStrongDirichletBC(bool strong);
 
+		/*!
+		 *	\brief	Set whether pressure gradient of corrector step is computed once per particle pair. Disabled by default.
+		 *
+		 *	Each pair is evaluated once, and its term added to both particles with atomics, which halves kernel
+		 *	evaluations, and pays off on devices with cheap atomics, like CPUs. Needs device support for global
+		 *	atomics (64-bit for double precision), and is not used with kernel correction or strong Dirichlet BC,
+		 *	since the gradient is not antisymmetric then.
+		 */
+		void SetPairwisePressureGradient(bool enable);
+
+		/*!
+		 *	\brief	Get whether pressure gradient of corrector step is computed once per particle pair.
+		 */
+		inline bool PairwisePressureGradient() { return pairwisePressureGradient; }
+
 		/*!
 		 *	\brief	Suggest next time step.
 		 *	\return	Time in seconds.
@@ -157,21 +258,105 @@ namespace isph {
 		unsigned int projectionOrder;
 		SolverType solverType;
 		unsigned int maxIterations;
+		unsigned int maxRefinements;
 		double solvingTolerance;
+		bool assembledMatrix;
+		bool deviceSolverScalars;
+		unsigned int solverCheckInterval;
+		PreconditionerType preconditioner;
+		std::vector<unsigned int> multigridCells;
+		bool warmStart;
 		double freeSurfaceFactor;
 		bool shifting;
 		double shiftingFactor;
 		unsigned int shiftingFrequency;
 		bool strongDirichletBC;
+		bool pairwisePressureGradient;
+
+		// subprograms enqueued in every solver iteration, resolved once
+		CLSubProgram* matrixVectorSubprogram;
+		CLSubProgram* dotSubprogram;
+		CLSubProgram* finishDotSubprogram;
+		CLSubProgram* dotPairSubprogram;
+		CLSubProgram* jacobiSubprogram;
+		CLSubProgram* dummyScalarSubprogram;
+		CLSubProgram* dummySolverScalarSubprogram;
 
 		virtual bool InitSph();
 		virtual bool PostInitSph();
 		virtual bool RunSph();
+		virtual bool EnqueueTimeStep(bool automatic);
+		virtual unsigned int StepVariant();
 
+		static bool SolvePressureCommand(void* simulation);
+		bool SolvePressure();
+		bool SolvePressureWithRefinement();
+		bool SolvePressureSystem();
 		bool SolvePressureWithCG();
 		bool SolvePressureWithBiCGSTAB();
+		bool SolvePressureWithCGOnDevice();
+		bool SolvePressureWithBiCGSTABOnDevice();
+		bool SolvePressureWithPipelinedCG();
+
+		bool EnqueueMatrixVectorProduct(size_t globalSize=0, size_t localSize=0);
+		bool InitialResidual(CLGlobalBuffer* product);
+		bool MatrixVectorProduct(CLGlobalBuffer* in, CLGlobalBuffer* out);
+		bool ApplyPreconditioner(CLGlobalBuffer* in, CLGlobalBuffer* out);
+		bool CopyToDummies(CLGlobalBuffer* buffer);
+
+		/*!
+		 *	\brief	Get tolerance of Krylov solver, with mixed precision it's bounded by single precision and refinement recovers the rest.
+		 */
+		inline double KrylovTolerance() { return MixedPrecision() ? (std::max)(solvingTolerance, 1e-4) : solvingTolerance; }
+
+		/*!
+		 *	\brief	Get whether Krylov solver starts from previous pressure, with mixed precision correction always starts from zero.
+		 */
+		inline bool KrylovWarmStart() { return warmStart && !MixedPrecision(); }
+
+		bool InitMultigrid();
+		bool AssembleMultigrid();
+		bool ApplyMultigrid(CLGlobalBuffer* in, CLGlobalBuffer* out);
+		bool EnqueueMultigridLevel(const std::string& name, unsigned int level, bool initialSweep = false);
 
 		double dot(CLGlobalBuffer* a, CLGlobalBuffer* b);
+
+		/*!
+		 *	\enum	KrylovScalar
+		 *	\brief	Indices of solver scalars kept on device, same as in isph/krylov_scalars.cl.
+		 */
+		enum KrylovScalar
+		{
+			KrylovRR,
+			KrylovRR0,
+			KrylovResidual,
+			KrylovAlpha,
+			KrylovBeta,
+			KrylovOmega,
+			KrylovTemp,
+			KrylovDone,
+			KrylovScalarCount
+		};
+
+		/*!
+		 *	\enum	KrylovOperation
+		 *	\brief	What to do with dot product finished on device, same as in isph/krylov_scalars.cl.
+		 */
+		enum KrylovOperation
+		{
+			KrylovInit,
+			KrylovStore,
+			KrylovComputeAlpha,
+			KrylovComputeOmega,
+			KrylovCheckResidual,
+			KrylovComputeCGBeta,
+			KrylovComputeBiCGSTABBeta,
+			KrylovComputePreconditionedBeta,
+			KrylovSetReference
+		};
+
+		bool dotOnDevice(CLGlobalBuffer* a, CLGlobalBuffer* b, KrylovOperation op);
+		bool EnqueueDotPair(CLGlobalBuffer* a, CLGlobalBuffer* b);
 	};
 
 }
@@ -1,10 +1,50 @@
 R"(
+
+/*!
+ *	\brief	Moment of kernel gradient of one neighbor, summed over neighbors into matrix that correction inverts
+ */
+sym_tensor KernelMoment(vector gradW, vector posDif)
+{
+#if DIM == 3
+	return -make_sym_tensor(posDif.x * gradW.x, posDif.x * gradW.y, posDif.x * gradW.z, posDif.y * gradW.y, posDif.y * gradW.z, posDif.z * gradW.z);
+#else
+	return -make_sym_tensor(posDif.x * gradW.x, posDif.x * gradW.y, posDif.y * gradW.y);
+#endif
+}
+
+/*!
+ *	\brief	Correction tensor from summed kernel gradient moments, no correction if they are badly conditioned
+ */
+sym_tensor KernelCorrectionTensor(sym_tensor m)
+{
+#if DIM == 3
+	scalar xx = m.s0, xy = m.s1, xz = m.s2, yy = m.s3, yz = m.s4, zz = m.s5;
+	scalar det = VOLUME*VOLUME*
+				( xx * (zz*yy - yz*yz)
+				- xy * (zz*xy - yz*xz)
+				+ xz * (yz*xy - yy*xz));
+
+	if(fabs(det) > 0.01) // check is well conditioned matrix
+		return make_sym_tensor(zz*yy-yz*yz, yz*xz-zz*xy, yz*xy-yy*xz, zz*xx-xz*xz, xy*xz-yz*xx, yy*xx-xy*xy) / det;
+	return make_sym_tensor(1, 0, 0, 1, 0, 1);
+#else
+	scalar det = VOLUME * (m.s0 * m.s2 - m.s1 * m.s1);
+
+	if(fabs(det) > 0.01 /*&& fabs(DxWx) > 0.2 && fabs(DyWy) > 0.2*/) // check is well conditioned matrix
+		return make_sym_tensor(m.s2, -m.s1, m.s0) / det;
+	return make_sym_tensor(1, 0, 1);
+#endif
+}
+
 __kernel void KernelNormalize
 (
 	__global sym_tensor *corr		: KERNEL_CORRECTION,
 	__global const char *typ		: CLASS,
 	__global const vector *pos 		: POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const uint *neighbors	: NEIGHBORS,
+	__global const uint *neighborCounts : NEIGHBOR_COUNTS,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes 	: HASHES,
 	uint particleCount				: PARTICLE_COUNT
 )
@@ -17,48 +57,14 @@ __kernel void KernelNormalize
 		return;
 
 	vector posI = pos[i];
-	scalar xx = 0;
-	scalar yy = 0;
-	scalar xy = 0;
-#if DIM == 3
-	scalar xz = 0;
-	scalar yz = 0;
-	scalar zz = 0;
-#endif
+	sym_tensor m = (sym_tensor)0;
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
-
-		vector gradW = SphKernelGrad(QSq, posDif);
-		xx -= posDif.x * gradW.x;
-		yy -= posDif.y * gradW.y;
-		xy -= posDif.x * gradW.y;
-#if DIM == 3
-		zz -= posDif.z * gradW.z;
-		xz -= posDif.x * gradW.z;
-		yz -= posDif.y * gradW.z;
-#endif
+	ForEachListedNeighbor(neighbors,neighborCounts,hashes,cellRanges,sortedPos,posI)
+		m += KernelMoment(SphKernelGrad(QSq, posDif), posDif);
 	ForEachEnd
 
-#if DIM == 3
-	scalar det = VOLUME*VOLUME*
-				( xx * (zz*yy - yz*yz)
-				- xy * (zz*xy - yz*xz)
-				+ xz * (yz*xy - yy*xz));
-
-	if(fabs(det) > 0.01) // check is well conditioned matrix
-		corr[i] = make_sym_tensor(zz*yy-yz*yz, yz*xz-zz*xy, yz*xy-yy*xz, zz*xx-xz*xz, xy*xz-yz*xx, yy*xx-xy*xy) / det;
-	else // no correction
-		corr[i] = make_sym_tensor(1, 0, 0, 1, 0, 1);
-#else
-	scalar det = VOLUME * (xx * yy - xy * xy);
-
-	if(fabs(det) > 0.01 /*&& fabs(DxWx) > 0.2 && fabs(DyWy) > 0.2*/) // check is well conditioned matrix
-		corr[i] = make_sym_tensor(yy, -xy, xx) / det;
-	else // no correction
-		corr[i] = make_sym_tensor(1, 0, 1);
-#endif
-
+	corr[i] = KernelCorrectionTensor(m);
 }
 
 vector CorrectGradW(vector gradW, sym_tensor c)
@@ -68,11 +74,35 @@ vector CorrectGradW(vector gradW, sym_tensor c)
 	return make_vector(
 			gradW.x*c.s0 + gradW.y*c.s1 + gradW.z*c.s2,
 			gradW.x*c.s1 + gradW.y*c.s3 + gradW.z*c.s4,
-			gradW.x*c.s2 + gradW.y*c.s4 + gradW.z*c.s5,
+			gradW.x*c.s2 + gradW.y*c.s4 + gradW.z*c.s5
 	);
 #else
 	return make_vector(dot(gradW, c.xy), dot(gradW, c.yz));
 #endif
 }
 
+/*!
+ *	\brief	Symmetric part of outer product of two vectors
+ */
+sym_tensor SymOuter(vector a, vector b)
+{
+#if DIM == 3
+	return make_sym_tensor(a.x*b.x, (a.x*b.y + a.y*b.x)/2, (a.x*b.z + a.z*b.x)/2, a.y*b.y, (a.y*b.z + a.z*b.y)/2, a.z*b.z);
+#else
+	return make_sym_tensor(a.x*b.x, (a.x*b.y + a.y*b.x)/2, a.y*b.y);
+#endif
+}
+
+/*!
+ *	\brief	Double contraction of symmetric tensors, dot(CorrectGradW(a, c), b) equals SymContract(c, SymOuter(a, b))
+ */
+scalar SymContract(sym_tensor c, sym_tensor t)
+{
+#if DIM == 3
+	return c.s0*t.s0 + c.s3*t.s3 + c.s5*t.s5 + 2*(c.s1*t.s1 + c.s2*t.s2 + c.s4*t.s4);
+#else
+	return c.s0*t.s0 + c.s2*t.s2 + 2*c.s1*t.s1;
+#endif
+}
+
 )" /* end OpenCL code */
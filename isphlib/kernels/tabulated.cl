@@ -0,0 +1,31 @@
+R"(
+
+/*!
+ *	\brief	Smoothing kernel interpolated from KERNEL_TABLE, sampled by host over squared distance.
+ */
+scalar SphKernel(scalar QSq)
+{
+	scalar x = min(QSq * KERNEL_TABLE_SCALE, (scalar)KERNEL_TABLE_SAMPLES);
+	uint k = min((uint)x, (uint)(KERNEL_TABLE_SAMPLES - 1));
+	return mix(KERNEL_TABLE[k], KERNEL_TABLE[k+1], x - k);
+}
+
+/*!
+ *	\brief	Smoothing kernel gradient interpolated from KERNEL_GRADIENT_TABLE, without sqrt and branches.
+ */
+vector SphKernelGrad(scalar QSq, vector distVec)
+{
+	scalar x = min(QSq * KERNEL_TABLE_SCALE, (scalar)KERNEL_TABLE_SAMPLES);
+	uint k = min((uint)x, (uint)(KERNEL_TABLE_SAMPLES - 1));
+	return distVec * mix(KERNEL_GRADIENT_TABLE[k], KERNEL_GRADIENT_TABLE[k+1], x - k);
+}
+
+/*!
+ *	\brief	Kernel compact support.
+ */
+scalar SphKernelSupport(scalar smoothInv) 
+{
+	return KERNEL_SUPPORT / smoothInv;
+}
+
+)" /* end OpenCL code */
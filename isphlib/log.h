@@ -71,6 +71,11 @@ namespace isph {
 		 */
 		static void SetLevel(MessageType level);
 
+		/*!
+		 *	\brief	Check if message of the type would be logged, before its text is made.
+		 */
+		static inline bool IsLogged(MessageType type) { return (int)type >= (int)logLevel; }
+
 	private:
 
 		static std::string outputFile;
@@ -79,11 +84,14 @@ namespace isph {
 		static void (*receiver)(const Message&);
 	};
 
-	// simple debug macro
-#ifdef NDEBUG
-	#define LogDebug(DESC)
+	// message text is evaluated only if the message passes the log level
+	#define LogMessage(TYPE, DESC) do { if(isph::Log::IsLogged(TYPE)) isph::Log::Send(TYPE, DESC); } while(0)
+
+	// simple debug macro, define ISPH_NO_DEBUG_LOG to compile debug messages out
+#if defined(NDEBUG) || defined(ISPH_NO_DEBUG_LOG)
+	#define LogDebug(DESC) do {} while(0)
 #else
-	#define LogDebug(DESC) Log::Send(Log::DebugInfo, DESC)
+	#define LogDebug(DESC) LogMessage(isph::Log::DebugInfo, DESC)
 #endif
 
 }
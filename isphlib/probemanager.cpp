@@ -242,6 +242,10 @@ void ProbeManager::PrepareData()
 
 	RecordSamplingTime(sim->Time());
 
+	// probes search neighbors by positions in cell order, so bring them up to date
+	if(!sim->ReorderPositions())
+		return;
+
 	// Cycle trough all required attributes
 	for (std::list<CLGlobalBuffer*>::const_iterator iter = attributeList.begin(); iter != attributeList.end(); ++iter)
 	{
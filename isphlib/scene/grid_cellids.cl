@@ -11,7 +11,7 @@ __kernel void ComputeCellIds
 	if(i < particleCount)
 		hash[i] = (int2)(CellHash(CellPos(pos[i])), i);
 	else
-		hash[i] = (int2)(-1, 0);
+		hash[i] = (int2)(-1, i);
 }
 
 )" /* end OpenCL code */
@@ -0,0 +1,28 @@
+R"(
+
+/*!
+ *	\brief	Flag hashes, in order of the last sort, whose particle changed cell.
+ *
+ *	Hashes keep their old cells, split kernel writes new ones to hashes that fit into moved list.
+ */
+__kernel void UpdateCellIds
+(
+	__global const int2 *hash		: HASHES,
+	__global uint *movedOffsets		: SORT_MOVED_OFFSETS,
+	__global const vector *pos		: POSITIONS,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	int2 h = hash[i];
+
+	// padding hashes hold index past the particles and stay out of grid
+	int cell = h.y < (int)particleCount ? CellHash(CellPos(pos[h.y])) : -1;
+	movedOffsets[i] = cell != h.x ? 1 : 0;
+
+	// extra last offset holds number of moved hashes after the scan
+	if(i == 0)
+		movedOffsets[get_global_size(0)] = 0;
+}
+
+)" /* end OpenCL code */
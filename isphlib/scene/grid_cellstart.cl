@@ -1,9 +1,14 @@
 R"(
 
-__kernel void FindCellStart
+/*!
+ *	\brief	Set [start,end) range of sorted particles in each cell, where hash changes. Empty cells stay cleared.
+ *
+ *	With SPARSE_GRID, ranges of occupied cells are inserted into hash table instead.
+ */
+__kernel void FindCellRanges
 (
 	__global const int2 *sortedHash	: HASHES,
-	__global uint *cellsStart		: CELLS_START,
+	__global uint2 *cellRanges		: CELL_RANGES,
 	__local int *localHash			: LOCAL_SIZE_INT,
 	uint particleCount				: PARTICLE_COUNT
 )
@@ -22,14 +27,35 @@ __kernel void FindCellStart
 
     barrier(CLK_LOCAL_MEM_FENCE);
 	
+#ifdef SPARSE_GRID
+	// first particle of cell finds where it ends, and claims free slot of the table for it
+	if(i < particleCount && hash.x != -1 && (i==0 || hash.x != localHash[j]))
+	{
+		uint end = (uint)i + 1;
+		while(end < particleCount && sortedHash[end].x == hash.x)
+			end++;
+
+		uint s = CellSlot(hash.x);
+		while(atomic_cmpxchg((volatile __global uint*)(cellRanges + s) + 1, 0u, end) != 0u)
+			s = (s + 1) & (CELL_TABLE_SIZE - 1);
+		cellRanges[s].x = (uint)i;
+	}
+#else
 	if(i < particleCount)
 	{
+		// cell of previous particle ends here
+		if(i>0 && hash.x != localHash[j] && localHash[j] != -1)
+			cellRanges[localHash[j]].y = (uint)i;
+
 		if(hash.x != -1)
 		{
 			if(i==0 || hash.x != localHash[j])
-				cellsStart[hash.x] = (uint)i;
+				cellRanges[hash.x].x = (uint)i;
+			if(i == particleCount-1)
+				cellRanges[hash.x].y = particleCount;
 		}
 	}
+#endif
 }
 
 )" /* end OpenCL code */
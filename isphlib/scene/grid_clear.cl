@@ -1,8 +1,8 @@
 R"(
 
-__kernel void ClearCellStart(__global uint* cellsStart : CELLS_START)
+__kernel void ClearCellRanges(__global uint2* cellRanges : CELL_RANGES)
 {
-	cellsStart[get_global_id(0)] = UINT_MAX;
+	cellRanges[get_global_id(0)] = (uint2)(0, 0);
 }
 
 )" /* end OpenCL code */
@@ -0,0 +1,22 @@
+R"(
+
+/*!
+ *	\brief	Clear ranges of cells occupied in the last refresh, where hash changes in the last sorted hashes.
+ */
+__kernel void ClearOccupiedCells
+(
+	__global const int2 *sortedHash	: HASHES,
+	__global uint2 *cellRanges		: CELL_RANGES,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i >= particleCount)
+		return;
+
+	int hash = sortedHash[i].x;
+	if(hash != -1 && (i == 0 || sortedHash[i-1].x != hash))
+		cellRanges[hash] = (uint2)(0, 0);
+}
+
+)" /* end OpenCL code */
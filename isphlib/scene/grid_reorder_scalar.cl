@@ -0,0 +1,19 @@
+R"(
+
+/*!
+ *	\brief	Gather scalar particle attribute into cell order of sorted hashes
+ */
+__kernel void ReorderScalars
+(
+	__global scalar *sorted			: SORTED_SCALAR,
+	__global const scalar *unsorted	: REORDER_SCALAR,
+	__global const int2 *hashes		: HASHES,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i < particleCount)
+		sorted[i] = unsorted[hashes[i].y];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,19 @@
+R"(
+
+/*!
+ *	\brief	Gather solver precision particle attribute into cell order of sorted hashes
+ */
+__kernel void ReorderSolverScalars
+(
+	__global solver_scalar *sorted			: SORTED_SOLVER_SCALAR,
+	__global const solver_scalar *unsorted	: REORDER_SOLVER_SCALAR,
+	__global const int2 *hashes				: HASHES,
+	uint particleCount						: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i < particleCount)
+		sorted[i] = unsorted[hashes[i].y];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,19 @@
+R"(
+
+/*!
+ *	\brief	Gather vector particle attribute into cell order of sorted hashes
+ */
+__kernel void ReorderVectors
+(
+	__global vector *sorted			: SORTED_VECTOR,
+	__global const vector *unsorted	: REORDER_VECTOR,
+	__global const int2 *hashes		: HASHES,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i < particleCount)
+		sorted[i] = unsorted[hashes[i].y];
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,57 @@
+R"(
+
+/*!
+ *	\brief	Merge sorted moved hashes with stayed ones back into HASHES.
+ *
+ *	Each hash finds its place by binary search in the other list. On equal keys stayed hashes go first.
+ */
+__kernel void MergeMovedHashes
+(
+	__global int2 *hash					: HASHES,
+	__global const int2 *moved			: SORT_MOVED,
+	__global const int2 *stayed			: SORT_STAYED,
+	__global const uint *movedCount		: SORT_MOVED_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	uint movedTotal = min(*movedCount, (uint)SORT_MOVED_CAPACITY);
+	uint stayedTotal = (uint)get_global_size(0) - movedTotal;
+	uint lo = 0;
+	uint hi;
+	uint mid;
+	int2 h;
+
+	if(i < stayedTotal)
+	{
+		// after moved hashes with smaller key
+		h = stayed[i];
+		hi = movedTotal;
+		while(lo < hi)
+		{
+			mid = (lo + hi) / 2;
+			if((uint)moved[mid].x < (uint)h.x)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		hash[i + lo] = h;
+	}
+	else
+	{
+		// after stayed hashes with smaller or equal key
+		uint j = i - stayedTotal;
+		h = moved[j];
+		hi = stayedTotal;
+		while(lo < hi)
+		{
+			mid = (lo + hi) / 2;
+			if((uint)stayed[mid].x <= (uint)h.x)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		hash[j + lo] = h;
+	}
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,36 @@
+R"(
+
+/*!
+ *	\brief	Compact hashes that changed cell into SORT_MOVED, and the rest, still sorted, into SORT_STAYED.
+ *
+ *	Unused moved slots are padded with out of grid hash, so they sort last.
+ *	Moved hashes that don't fit stay with their old cell, so merged HASHES remain sorted until host sorts them all again.
+ */
+__kernel void SplitMovedHashes
+(
+	__global const int2 *hash			: HASHES,
+	__global const uint *movedOffsets	: SORT_MOVED_OFFSETS,
+	__global int2 *moved				: SORT_MOVED,
+	__global int2 *stayed				: SORT_STAYED,
+	__global uint *movedCount			: SORT_MOVED_COUNT,
+	__global const vector *pos			: POSITIONS
+)
+{
+	size_t i = get_global_id(0);
+	int2 h = hash[i];
+	uint offset = movedOffsets[i];
+	uint total = movedOffsets[get_global_size(0)];
+
+	if(movedOffsets[i+1] != offset && offset < SORT_MOVED_CAPACITY)
+		moved[offset] = (int2)(CellHash(CellPos(pos[h.y])), h.y);
+	else
+		stayed[i - min(offset, (uint)SORT_MOVED_CAPACITY)] = h;
+
+	if(i >= total && i < SORT_MOVED_CAPACITY)
+		moved[i] = (int2)(-1, 0);
+
+	if(i == 0)
+		*movedCount = total;
+}
+
+)" /* end OpenCL code */
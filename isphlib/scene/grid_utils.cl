@@ -2,6 +2,105 @@ R"(
 
 #define KERNEL_SUPPORT_SQ (KERNEL_SUPPORT*KERNEL_SUPPORT)
 
+/*!
+ *	Neighbor loops read positions from SORTED_POSITIONS, which is in cell order, so inside the
+ *	loop _j is the sorted index of neighbor and j its original index. Other attributes kept
+ *	in cell order (SORTED_* semantics) should be indexed with SORTED_J, since they are only
+ *	reordered when REORDER_PARTICLES is defined, and otherwise connected to unsorted buffers.
+ */
+#ifdef REORDER_PARTICLES
+#define SORTED_I _i
+#define SORTED_J _j
+#else
+#define SORTED_I i
+#define SORTED_J j
+#endif
+
+/*!
+ *	With MORTON_CELLS defined, cell hash is Z-order (Morton) code of cell coordinates, with their bits
+ *	interleaved, instead of row-major index. Particles sorted by hash are then close in sorted order
+ *	when they are close in space along any axis. Hashes of cells in grid aren't contiguous then,
+ *	so CELL_TOTAL is the number of hashes up to the last cell, and the ones between cells are empty.
+ */
+#ifdef MORTON_CELLS
+#if DIM == 3
+
+uint MortonSpread(uint v)
+{
+	v &= 0x000003ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+uint MortonCompact(uint v)
+{
+	v &= 0x09249249;
+	v = (v | (v >> 2)) & 0x030c30c3;
+	v = (v | (v >> 4)) & 0x0300f00f;
+	v = (v | (v >> 8)) & 0x030000ff;
+	v = (v | (v >> 16)) & 0x000003ff;
+	return v;
+}
+
+#else
+
+uint MortonSpread(uint v)
+{
+	v &= 0x0000ffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+uint MortonCompact(uint v)
+{
+	v &= 0x55555555;
+	v = (v | (v >> 1)) & 0x33333333;
+	v = (v | (v >> 2)) & 0x0f0f0f0f;
+	v = (v | (v >> 4)) & 0x00ff00ff;
+	v = (v | (v >> 8)) & 0x0000ffff;
+	return v;
+}
+
+#endif
+#endif
+
+/*!
+ *	With SPARSE_GRID defined, CELL_RANGES is an open-addressing hash table of occupied cells with
+ *	CELL_TABLE_SIZE slots, instead of an entry for every cell of the grid. Cell takes the first free slot
+ *	from CellSlot on, and since slot holds only the range, its cell is recognized by hash of the first
+ *	particle in range. Empty slot, with zero range, ends probing. Use CellRange to read range of cell hash.
+ */
+#ifdef SPARSE_GRID
+
+inline uint CellSlot(int hash)
+{
+	return ((uint)hash * 2654435769u) >> (32 - CELL_TABLE_BITS);
+}
+
+uint2 SparseCellRange(__global const uint2 *cellRanges, __global const int2 *hashes, int hash)
+{
+	for(uint s=CellSlot(hash); ; s=(s+1)&(CELL_TABLE_SIZE-1))
+	{
+		uint2 range = cellRanges[s];
+		if(range.y == 0 || hashes[range.x].x == hash)
+			return range;
+	}
+}
+
+#define CellRange(CELL_RANGES,HASHES,HASH) SparseCellRange(CELL_RANGES,HASHES,HASH)
+
+#else
+
+#define CellRange(CELL_RANGES,HASHES,HASH) CELL_RANGES[HASH]
+
+#endif
+
 #if DIM == 3
 
 
@@ -22,7 +121,20 @@ int CellHash(int4 cell)
 		return -1;
 	if(cell.x < 0 || cell.y < 0 || cell.z < 0)
 		return -1;
+#ifdef MORTON_CELLS
+	return (int)(MortonSpread(cell.x) | (MortonSpread(cell.y) << 1) | (MortonSpread(cell.z) << 2));
+#else
 	return cell.x + (cell.y * CELL_COUNT.x) + (cell.z * CELL_COUNT.x * CELL_COUNT.y);
+#endif
+}
+
+int4 CellCoords(uint hash)
+{
+#ifdef MORTON_CELLS
+	return (int4)(MortonCompact(hash), MortonCompact(hash >> 1), MortonCompact(hash >> 2), 0);
+#else
+	return (int4)(hash % CELL_COUNT.x, (hash / CELL_COUNT.x) % CELL_COUNT.y, hash / (CELL_COUNT.x * CELL_COUNT.y), 0);
+#endif
 }
 
 #define ForEachSetup(POS) \
@@ -31,18 +143,18 @@ int CellHash(int4 cell)
 	int4 _loopEnd = min(_cellI+(int4)1, CELL_COUNT_1); \
 	int4 _cellJ;
 
-#define ForEachNeighbor(HASHES,CELLS_START,POSITIONS,POS_I) \
+#define ForEachCellNeighbor(HASHES,CELL_RANGES,POSITIONS,POS_I,QSQ_MAX) \
 	for(_cellJ.x=_loopStart.x; _cellJ.x<=_loopEnd.x; _cellJ.x++) \
 	for(_cellJ.y=_loopStart.y; _cellJ.y<=_loopEnd.y; _cellJ.y++) \
 	for(_cellJ.z=_loopStart.z; _cellJ.z<=_loopEnd.z; _cellJ.z++){ \
 		int _hash = CellHash(_cellJ); \
-		uint _j = CELLS_START[_hash]; \
-		if(_j == UINT_MAX) continue; \
-		for(int2 particleJ=HASHES[_j]; _hash==particleJ.x; particleJ=HASHES[++_j]){ \
-			int j = particleJ.y; if(j==i) continue; \
-			vector posDif = POS_I - POSITIONS[j]; \
-			scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
-			if(QSq >= KERNEL_SUPPORT_SQ) continue;
+		uint2 _range = CellRange(CELL_RANGES,HASHES,_hash); { \
+			for(uint _j=_range.x; _j<_range.y; _j++){ \
+				int2 particleJ = HASHES[_j]; \
+				int j = particleJ.y; if(j!=i) { \
+					vector posDif = POS_I - POSITIONS[_j]; \
+					scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
+					if(QSq < QSQ_MAX) {
 
 #else
 
@@ -60,7 +172,22 @@ int CellHash(int2 cell)
    //	return -1;
    //if(cell.x < 0 || cell.y < 0)
    //	return -1;
+#ifdef MORTON_CELLS
+	if(cell.x < 0 || cell.y < 0)
+		return -1;
+	return (int)(MortonSpread(cell.x) | (MortonSpread(cell.y) << 1));
+#else
 	return cell.y * CELL_COUNT.x + cell.x;
+#endif
+}
+
+int2 CellCoords(uint hash)
+{
+#ifdef MORTON_CELLS
+	return (int2)(MortonCompact(hash), MortonCompact(hash >> 1));
+#else
+	return (int2)(hash % CELL_COUNT.x, hash / CELL_COUNT.x);
+#endif
 }
 
 #define ForEachSetup(POS) \
@@ -68,17 +195,189 @@ int CellHash(int2 cell)
    int2 _loopEnd   = CellPos(POS + KERNEL_SUPPORT_RADIUSES); \
 	int2 _cellJ;
 
-#define ForEachNeighbor(HASHES,CELLS_START,POSITIONS,POS_I) \
+#define ForEachCellNeighbor(HASHES,CELL_RANGES,POSITIONS,POS_I,QSQ_MAX) \
 	for(_cellJ.y=_loopStart.y; _cellJ.y<=_loopEnd.y; _cellJ.y++) \
 	for(_cellJ.x=_loopStart.x; _cellJ.x<=_loopEnd.x; _cellJ.x++){ \
 		int _hash = CellHash(_cellJ); \
-		uint _j = CELLS_START[_hash]; \
-      if(_j != UINT_MAX){ \
-         for(int2 particleJ=HASHES[_j]; _hash==particleJ.x; particleJ=HASHES[++_j]){ \
+		uint2 _range = CellRange(CELL_RANGES,HASHES,_hash); { \
+         for(uint _j=_range.x; _j<_range.y; _j++){ \
+            int2 particleJ = HASHES[_j]; \
             int j = particleJ.y; if(j!=i) { \
-               vector posDif = POS_I - POSITIONS[j]; \
+               vector posDif = POS_I - POSITIONS[_j]; \
                scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
-               if(QSq < KERNEL_SUPPORT_SQ) {
+               if(QSq < QSQ_MAX) {
+
+#endif
+
+#define ForEachNeighbor(HASHES,CELL_RANGES,POSITIONS,POS_I) \
+	ForEachCellNeighbor(HASHES,CELL_RANGES,POSITIONS,POS_I,KERNEL_SUPPORT_SQ)
+
+/*!
+ *	Loop over half of neighbors, for kernels that run over particles in cell order (_i is sorted index)
+ *	and compute each pair once. Since particles are sorted by cell hash, neighbor with greater sorted
+ *	index is in the same cell after i, or in a cell with greater hash, so cells with smaller hash are skipped.
+ *	Contributions to j have to be added atomically, since other work items add to it too.
+ */
+#define ForEachPairNeighbor(HASHES,CELL_RANGES,POSITIONS,POS_I) \
+	int _hashI = HASHES[_i].x; \
+	ForEachCellPair(HASHES,CELL_RANGES,POSITIONS,POS_I,_hashI)
+
+#if DIM == 3
+#define ForEachCellPair(HASHES,CELL_RANGES,POSITIONS,POS_I,HASH_I) \
+	for(_cellJ.x=_loopStart.x; _cellJ.x<=_loopEnd.x; _cellJ.x++) \
+	for(_cellJ.y=_loopStart.y; _cellJ.y<=_loopEnd.y; _cellJ.y++) \
+	for(_cellJ.z=_loopStart.z; _cellJ.z<=_loopEnd.z; _cellJ.z++){ \
+		int _hash = CellHash(_cellJ); \
+		uint2 _range = _hash < HASH_I ? (uint2)(0, 0) : CellRange(CELL_RANGES,HASHES,_hash); \
+		if(_hash == HASH_I) _range.x = (uint)_i + 1; { \
+			for(uint _j=_range.x; _j<_range.y; _j++){ \
+				int2 particleJ = HASHES[_j]; \
+				int j = particleJ.y; { \
+					vector posDif = POS_I - POSITIONS[_j]; \
+					scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
+					if(QSq < KERNEL_SUPPORT_SQ) {
+#else
+#define ForEachCellPair(HASHES,CELL_RANGES,POSITIONS,POS_I,HASH_I) \
+	for(_cellJ.y=_loopStart.y; _cellJ.y<=_loopEnd.y; _cellJ.y++) \
+	for(_cellJ.x=_loopStart.x; _cellJ.x<=_loopEnd.x; _cellJ.x++){ \
+		int _hash = CellHash(_cellJ); \
+		uint2 _range = _hash < HASH_I ? (uint2)(0, 0) : CellRange(CELL_RANGES,HASHES,_hash); \
+		if(_hash == HASH_I) _range.x = (uint)_i + 1; { \
+			for(uint _j=_range.x; _j<_range.y; _j++){ \
+				int2 particleJ = HASHES[_j]; \
+				int j = particleJ.y; { \
+					vector posDif = POS_I - POSITIONS[_j]; \
+					scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
+					if(QSq < KERNEL_SUPPORT_SQ) {
+#endif
+
+/*!
+ *	Tiled neighbor loops, for kernels run by work-groups of TILE_SIZE work items, one group per grid cell.
+ *	Particles of the cell are processed in chunks of TILE_SIZE (_i is sorted index, i original one, valid if _validI).
+ *	For each chunk of particles in neighbor cells, work item stages its particle (_j, j, valid if _validJ)
+ *	to local memory, and after TileStaged all of them loop over _chunkCount staged neighbors, _k indexing them.
+ *	Loops are the same for the whole group, since there are barriers in them.
+ */
+#ifdef TILED_KERNELS
+
+#if DIM == 3
+#define ForEachTileCell \
+	for(_cellJ.z=_loopStart.z; _cellJ.z<=_loopEnd.z; _cellJ.z++) \
+	for(_cellJ.y=_loopStart.y; _cellJ.y<=_loopEnd.y; _cellJ.y++) \
+	for(_cellJ.x=_loopStart.x; _cellJ.x<=_loopEnd.x; _cellJ.x++)
+#else
+#define ForEachTileCell \
+	for(_cellJ.y=_loopStart.y; _cellJ.y<=_loopEnd.y; _cellJ.y++) \
+	for(_cellJ.x=_loopStart.x; _cellJ.x<=_loopEnd.x; _cellJ.x++)
+#endif
+
+#define ForEachTileParticle(HASHES,CELL_RANGES) \
+	uint _cell = get_group_id(0); \
+	uint _l = get_local_id(0); \
+	uint2 _cellRange = CELL_RANGES[_cell]; \
+	int_vector _cellI = CellCoords(_cell); \
+	int_vector _loopStart = max(_cellI-(int_vector)1, (int_vector)0); \
+	int_vector _loopEnd = min(_cellI+(int_vector)1, CELL_COUNT_1); \
+	int_vector _cellJ; \
+	for(uint _first=_cellRange.x; _first<_cellRange.y; _first+=TILE_SIZE){ \
+		uint _i = _first + _l; \
+		bool _validI = _i < _cellRange.y; \
+		int i = _validI ? HASHES[_i].y : 0;
+
+#define ForEachTileNeighborChunk(HASHES,CELL_RANGES) \
+		ForEachTileCell{ \
+			int _hash = CellHash(_cellJ); \
+			uint2 _chunkRange = CellRange(CELL_RANGES,HASHES,_hash); \
+			for(uint _chunk=_chunkRange.x; _chunk<_chunkRange.y; _chunk+=TILE_SIZE){ \
+				uint _chunkCount = min((uint)TILE_SIZE, _chunkRange.y - _chunk); \
+				uint _j = _chunk + _l; \
+				bool _validJ = _l < _chunkCount; \
+				int j = _validJ ? HASHES[_j].y : 0;
+
+#define TileStaged \
+				barrier(CLK_LOCAL_MEM_FENCE);
+
+#define ForEachTileNeighbor(TILE_POSITIONS,POS_I,ACTIVE) \
+				if(ACTIVE) for(uint _k=0; _k<_chunkCount; _k++){ \
+					if(_chunk + _k != _i){ \
+						vector posDif = POS_I - TILE_POSITIONS[_k]; \
+						scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
+						if(QSq < KERNEL_SUPPORT_SQ) {
+
+#define ForEachTileNeighborEnd }}}
+
+#define ForEachTileNeighborChunkEnd \
+				barrier(CLK_LOCAL_MEM_FENCE); \
+			} \
+		}
+
+#define ForEachTileParticleEnd \
+	}
+
+#endif
+
+/*!
+ *	Atomic addition of floating point values, for pair-wise kernels. OpenCL has only integer atomics,
+ *	so it's a compare-and-swap loop on the bits of value, 64-bit one for double precision.
+ */
+#ifdef PAIRWISE_ATOMICS
+
+#if FP == 64
+#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable
+#endif
+
+void AtomicAddScalar(volatile __global scalar *sum, scalar value)
+{
+#if FP == 64
+	ulong expected, previous = as_ulong(*sum);
+	do
+	{
+		expected = previous;
+		previous = atom_cmpxchg((volatile __global ulong*)sum, expected, as_ulong(as_double(expected) + value));
+	}
+	while(previous != expected);
+#else
+	uint expected, previous = as_uint(*sum);
+	do
+	{
+		expected = previous;
+		previous = atomic_cmpxchg((volatile __global uint*)sum, expected, as_uint(as_float(expected) + value));
+	}
+	while(previous != expected);
+#endif
+}
+
+void AtomicAddVector(__global vector *sum, vector value)
+{
+	volatile __global scalar *s = (volatile __global scalar*)sum;
+	AtomicAddScalar(s, value.x);
+	AtomicAddScalar(s + 1, value.y);
+#if DIM == 3
+	AtomicAddScalar(s + 2, value.z);
+#endif
+}
+
+#endif
+
+/*!
+ *	Loop over neighbors stored in Verlet lists, built by BuildNeighborLists with support radius plus skin.
+ *	Lists are stored column-wise, k-th neighbor of particle i is at NEIGHBORS[k*NEIGHBOR_LIST_STRIDE + i],
+ *	and hold sorted indices of neighbors. Without NEIGHBOR_LISTS defined, it falls back to grid search.
+ */
+#ifdef NEIGHBOR_LISTS
+
+#define ForEachListedNeighbor(NEIGHBORS,NEIGHBOR_COUNTS,HASHES,CELL_RANGES,POSITIONS,POS_I) \
+	for(uint _k=0, _kEnd=min(NEIGHBOR_COUNTS[i], (uint)MAX_NEIGHBORS); _k<_kEnd; _k++){ { { \
+		uint _j = NEIGHBORS[_k*NEIGHBOR_LIST_STRIDE + i]; \
+		int j = HASHES[_j].y; { \
+			vector posDif = POS_I - POSITIONS[_j]; \
+			scalar QSq = dot(posDif, posDif) * SMOOTHING_LENGTH_INV_SQ; \
+			if(QSq < KERNEL_SUPPORT_SQ) {
+
+#else
+
+#define ForEachListedNeighbor(NEIGHBORS,NEIGHBOR_COUNTS,HASHES,CELL_RANGES,POSITIONS,POS_I) \
+	ForEachNeighbor(HASHES,CELL_RANGES,POSITIONS,POS_I)
 
 #endif
 
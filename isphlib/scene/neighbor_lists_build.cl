@@ -0,0 +1,42 @@
+R"(
+
+/*!
+ *	\brief	Store neighbors within support radius plus skin, and remember positions lists were built at
+ *
+ *	Lists longer than MAX_NEIGHBORS are truncated, and the greatest such count is kept in NEIGHBOR_OVERFLOW for host.
+ */
+__kernel void BuildNeighborLists
+(
+	__global uint *neighbors		: NEIGHBORS,
+	__global uint *neighborCounts	: NEIGHBOR_COUNTS,
+	__global vector *listedPos		: POSITIONS_LISTED,
+	__global const vector *pos 		: POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes 	: HASHES,
+	__global uint *overflow			: NEIGHBOR_OVERFLOW,
+	uint particleCount				: PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i >= particleCount)
+		return;
+
+	vector posI = pos[i];
+	uint count = 0;
+
+	ForEachSetup(posI)
+	ForEachCellNeighbor(hashes,cellRanges,sortedPos,posI,NEIGHBOR_SEARCH_SQ)
+		if(count < MAX_NEIGHBORS)
+			neighbors[count*NEIGHBOR_LIST_STRIDE + i] = _j;
+		count++;
+	ForEachEnd
+
+	if(count > MAX_NEIGHBORS)
+		atomic_max(overflow, count);
+
+	neighborCounts[i] = count;
+	listedPos[i] = posI;
+}
+
+)" /* end OpenCL code */
@@ -0,0 +1,78 @@
+R"(
+
+/*!
+ *	\brief	Find maximum squared displacement of particles since neighbor lists were built
+ */
+__kernel void MaxDisplacementSquared
+(
+	__global const vector *pos			: POSITIONS,
+	__global const vector *listedPos	: POSITIONS_LISTED,
+	__global scalar *g_odata			: OUT_MAX_DISPLACEMENTS,
+	__local scalar *sdata				: LOCAL_MAX_DISPLACEMENTS,
+	uint n								: PARTICLE_COUNT
+)
+{
+
+#ifdef CPU
+
+	size_t grid_size  = get_global_size(0);
+	size_t chunk_size = (n + grid_size - 1) / grid_size;
+	size_t start      = min((size_t)n, chunk_size * get_global_id(0));
+	size_t stop       = min((size_t)n, start + chunk_size);
+	
+	scalar maxDisp    = (scalar)0;
+	vector vec;
+	for (size_t i = start; i < stop; i++)
+	{
+		vec = pos[i] - listedPos[i];
+		maxDisp = max(maxDisp, dot(vec,vec));
+	}
+	g_odata[get_group_id(0)] = maxDisp;
+
+#else
+
+	size_t tid        = get_local_id(0);
+	size_t block_size = get_local_size(0);
+	size_t p          = get_group_id(0) * block_size * 2 + tid;
+	size_t gridSize   = get_num_groups(0) * block_size * 2;
+
+	size_t i;
+	scalar maxDisp    = (scalar)0;
+	vector vec;
+	while (p < n)
+	{
+		i = p;
+		vec = pos[i] - listedPos[i];
+		maxDisp = max(maxDisp, dot(vec,vec));
+		i = p + block_size;
+		if (i < n)
+		{
+			vec = pos[i] - listedPos[i];
+			maxDisp = max(maxDisp, dot(vec,vec));
+		}
+		p += gridSize;
+	}
+	sdata[tid] = maxDisp;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (block_size >= 1024) { if (tid < 512) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid + 512]); } barrier(CLK_LOCAL_MEM_FENCE); }
+	if (block_size >=  512) { if (tid < 256) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid + 256]); } barrier(CLK_LOCAL_MEM_FENCE); }
+	if (block_size >=  256) { if (tid < 128) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid + 128]); } barrier(CLK_LOCAL_MEM_FENCE); }
+	if (block_size >=  128) { if (tid <  64) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid +  64]); } barrier(CLK_LOCAL_MEM_FENCE); }
+
+	if (tid < 32)
+	{
+		if (block_size >= 64) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid + 32]); }
+		if (block_size >= 32) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid + 16]); }
+		if (block_size >= 16) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid +  8]); }
+		if (block_size >=  8) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid +  4]); }
+		if (block_size >=  4) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid +  2]); }
+		if (block_size >=  2) { sdata[tid] = maxDisp = max(maxDisp, sdata[tid +  1]); }
+	}
+
+	if (tid == 0)
+		g_odata[get_group_id(0)] = sdata[0];
+#endif
+}
+
+)" /* end OpenCL code */
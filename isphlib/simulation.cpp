@@ -1,7 +1,10 @@
 #include "simulation.h"
 #include "isph.h"
 #include "extern/clpp/clpp.h"
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <sstream>
 #include <stack>
 #include <queue>
 #include <set>
@@ -20,15 +23,35 @@ Simulation::Simulation(unsigned int simDimensions, VariableDataType scalarDataTy
 	, smoothingKernel(CubicSplineKernel)
 	, smoothingLength(0)
 	, smoothingKernelCorrection(false)
+	, supportRadius(0)
+	, tabulatedKernel(false)
+	, kernelTableSamples(2048)
 	, density(0)
 	, dynamicViscosity(0)
 	, gridCellSize(0)
+	, reorderParticles(false)
+	, mortonCells(false)
+	, sparseGrid(false)
+	, incrementalSort(false)
+	, hashesSorted(false)
+	, clearOccupiedCells(false)
+	, sortMovedCapacity(0)
+	, tiledKernels(false)
+	, gridCellTotal(0)
+	, neighborLists(false)
+	, neighborSkinFactor(0.1)
+	, neighborSkin(0)
+	, neighborListsValid(false)
+	, listedRefreshes(0)
+	, displacementCheckRefresh(1)
 	, maxTime(0)
 	, wantedTimeStep(0)
 	, timeOverall(0)
 	, timeStep(0)
 	, cflFactor(1.0)
 	, timeStepCount(0)
+	, timeSyncInterval(10)
+	, timeSynced(true)
 	, timeStepTimer(0)
 	, asyncExport(true)
 {
@@ -48,6 +71,7 @@ Simulation::Simulation(unsigned int simDimensions, VariableDataType scalarDataTy
 		scalarType = DoubleType;
 	else
 		scalarType = FloatType;
+	mixedPrecision = false;
 }
 
 
@@ -81,6 +105,165 @@ void Simulation::SetSmoothingKernel(SmoothingKernelType type, double length, boo
 }
 
 
+void Simulation::SetTabulatedKernel(bool enabled, unsigned int samples)
+{
+	tabulatedKernel = enabled;
+	if(samples < 2)
+	{
+		Log::Send(Log::Warning, "Kernel table needs at least 2 samples");
+		samples = 2;
+	}
+	kernelTableSamples = samples;
+}
+
+
+double Simulation::KernelValue(double qSq)
+{
+	double q = sqrt(qSq);
+	double hInvDim = pow(smoothingLength, -(int)dimensions);
+	double c, d;
+
+	switch(smoothingKernel)
+	{
+	case QuadraticKernel:
+		c = (dimensions == 3 ? 15 * M_1_PI / 16 : 3 * M_1_PI / 2) * hInvDim;
+		return c * (0.25*qSq - q + 1);
+	case CubicSplineKernel:
+		c = (dimensions == 3 ? M_1_PI : 10 * M_1_PI / 7) * hInvDim;
+		if(q < 1.0)
+			return c * (1 - 1.5*qSq + 0.75*qSq*q);
+		return c / 4 * pow(2 - q, 3);
+	case QuinticSplineKernel:
+		c = (dimensions == 3 ? M_1_PI / 120 : 7 * M_1_PI / 478) * hInvDim;
+		if(q < 1.0)
+			return c * (pow(3-q,5) - 6*pow(2-q,5) + 15*pow(1-q,5));
+		else if(q < 2.0)
+			return c * (pow(3-q,5) - 6*pow(2-q,5));
+		return c * pow(3-q,5);
+	case GaussKernel:
+		c = (dimensions == 3 ? 0.1795871221251665617 : M_1_PI) * hInvDim;
+		return c * exp(-qSq);
+	case ModifiedGaussKernel:
+		c = (dimensions == 3 ? 0.1795871221251665617 : M_1_PI) * hInvDim;
+		d = exp(-9.0);
+		return c * (exp(-qSq) - d) / (1 - 10 * d);
+	case WendlandKernel:
+		c = (dimensions == 3 ? 7 * M_1_PI / 8 : 7 * M_1_PI / 4) * hInvDim;
+		return std::max(c * pow(1 - 0.5*q, 4), 0.0);
+	}
+
+	return 0;
+}
+
+
+double Simulation::KernelGradientFactor(double qSq)
+{
+	double q = sqrt(qSq);
+	double hInvSq = 1.0 / (smoothingLength * smoothingLength);
+	double hInvDim = pow(smoothingLength, -(int)dimensions);
+	double c, d;
+
+	switch(smoothingKernel)
+	{
+	case QuadraticKernel:
+		c = (dimensions == 3 ? 15 * M_1_PI / 16 : 3 * M_1_PI / 2) * hInvDim * hInvSq;
+		return c * (0.5 - 1 / q);
+	case CubicSplineKernel:
+		c = -3 * (dimensions == 3 ? M_1_PI : 10 * M_1_PI / 7) * hInvDim * hInvSq;
+		if(qSq <= 1)
+			return c * (1 - 0.75*q);
+		return c / 4 * (2 - q) * (2 - q) / q;
+	case QuinticSplineKernel:
+		c = -5 * (dimensions == 3 ? M_1_PI / 120 : 7 * M_1_PI / 478) * hInvDim * hInvSq;
+		if(q < 1.0)
+			return c / q * (pow(3-q,4) - 6*pow(2-q,4) + 15*pow(1-q,4));
+		else if(q < 2.0)
+			return c / q * (pow(3-q,4) - 6*pow(2-q,4));
+		return c / q * pow(3-q,4);
+	case GaussKernel:
+		c = -2 * (dimensions == 3 ? 0.1795871221251665617 : M_1_PI) * hInvDim * hInvSq;
+		return c * exp(-qSq);
+	case ModifiedGaussKernel:
+		c = -2 * (dimensions == 3 ? 0.1795871221251665617 : M_1_PI) * hInvDim * hInvSq;
+		d = exp(-9.0);
+		return c * exp(-qSq) / (1 - 10 * d);
+	case WendlandKernel:
+		c = -5 * (dimensions == 3 ? 7 * M_1_PI / 8 : 7 * M_1_PI / 4) * hInvDim / smoothingLength;
+		d = std::max(2 - q, 0.0);
+		return c * d * d / q;
+	}
+
+	return 0;
+}
+
+
+bool Simulation::LoadKernelTable()
+{
+	// same as KERNEL_SUPPORT of analytic kernels, neighbors are within it
+	int support = (smoothingKernel == QuinticSplineKernel || smoothingKernel == GaussKernel || smoothingKernel == ModifiedGaussKernel) ? 3 : 2;
+	unsigned int samples = kernelTableSamples;
+	double step = (double)(support * support) / samples;
+
+	std::vector<double> values(samples + 1), gradients(samples + 1);
+	for(unsigned int k=0; k<=samples; k++)
+	{
+		values[k] = KernelValue(k * step);
+		gradients[k] = KernelGradientFactor(k * step);
+	}
+
+	// gradients divide by distance, so first sample is extrapolated
+	gradients[0] = 2 * gradients[1] - gradients[2];
+
+	// compare interpolation to analytic kernel in the middle of intervals
+	double maxValue = 0, maxGradient = 0, valueError = 0, gradientError = 0;
+	for(unsigned int k=0; k<samples; k++)
+	{
+		double qSq = (k + 0.5) * step;
+		maxValue = std::max(maxValue, fabs(values[k]));
+		maxGradient = std::max(maxGradient, fabs(gradients[k+1]));
+		valueError = std::max(valueError, fabs(0.5 * (values[k] + values[k+1]) - KernelValue(qSq)));
+		if(k > 0)
+			gradientError = std::max(gradientError, fabs(0.5 * (gradients[k] + gradients[k+1]) - KernelGradientFactor(qSq)));
+	}
+	valueError /= maxValue;
+	gradientError /= maxGradient;
+
+	Log::Send(Log::Info, "Tabulated kernel with " + Utils::IntegerString(samples) + " samples, relative error of value: "
+		+ Utils::DoubleString(valueError) + ", of gradient: " + Utils::DoubleString(gradientError));
+	if(valueError > 1e-3 || gradientError > 1e-3)
+		Log::Send(Log::Warning, "Tabulated kernel differs from analytic one, increase number of samples");
+
+	// 64KB is the least constant memory devices have
+	size_t tableSize = 2 * (samples + 1) * (scalarType == DoubleType ? sizeof(double) : sizeof(float));
+	if(tableSize > 65536)
+		Log::Send(Log::Warning, "Kernel tables take " + Utils::IntegerString((int)tableSize) + " bytes, which may not fit in constant memory");
+
+	// tables are program scope constants, so kernels don't need them as arguments
+	std::ostringstream source;
+	const char* suffix = scalarType == DoubleType ? "" : "f";
+	source << std::scientific;
+	source.precision(scalarType == DoubleType ? 16 : 8);
+	source << "#define KERNEL_SUPPORT " << support << "\n";
+	source << "#define KERNEL_TABLE_SAMPLES " << samples << "\n";
+	source << "#define KERNEL_TABLE_SCALE " << (1.0 / step) << suffix << "\n";
+	source << "__constant scalar KERNEL_TABLE[" << samples + 1 << "] = {";
+	for(unsigned int k=0; k<=samples; k++)
+		source << (k ? "," : "") << values[k] << suffix;
+	source << "};\n";
+	source << "__constant scalar KERNEL_GRADIENT_TABLE[" << samples + 1 << "] = {";
+	for(unsigned int k=0; k<=samples; k++)
+		source << (k ? "," : "") << gradients[k] << suffix;
+	source << "};\n";
+
+	if(!LoadSubprogram("kernel table", source.str()))
+		return false;
+
+   return LoadSubprogram("kernel",
+                         #include "kernels/tabulated.cl"
+                         );
+}
+
+
 void Simulation::SetDensity( double density )
 {
 	if(density < DBL_EPSILON)
@@ -113,7 +296,7 @@ void Simulation::SetBoundaries(Vec<3,double> boundsMin, Vec<3,double> boundsMax)
 }
 
 
-bool Simulation::LoadSubprogram(const std::string& name, const std::string& source)
+bool Simulation::LoadSubprogram(const std::string& name, const std::string& source, bool reachable)
 {
 	CLSubProgram *sp;
 	std::map<std::string,CLSubProgram*>::iterator found = subprograms.find(name);
@@ -127,6 +310,7 @@ bool Simulation::LoadSubprogram(const std::string& name, const std::string& sour
 		sp = found->second;
 
    bool success = sp->SetSource(source);
+	sp->SetEnabled(reachable);
 	program->AddSubprogram(sp);
 	return success;
 }
@@ -134,39 +318,57 @@ bool Simulation::LoadSubprogram(const std::string& name, const std::string& sour
 
 bool Simulation::EnqueueSubprogram(const std::string& name, size_t globalSize, size_t localSize)
 {
-	std::map<std::string,CLSubProgram*>::iterator found = subprograms.find(name);
+	CLSubProgram *sp = Subprogram(name);
 
-	if(found != subprograms.end())
+	if(!sp)
 	{
-		CLSubProgram *sp = found->second;
+		Log::Send(Log::Error, "Subprogram you want to enqueue doesn't exist: " + name);
+		return false;
+	}
 
-		if(!sp->Enqueue(globalSize, localSize))
-		{
-			Log::Send(Log::Error, "Error while executing subprogram: " + sp->KernelName());
-			return false;
-		}
-		return true;
+	return EnqueueSubprogram(sp, globalSize, localSize);
+}
 
-		/*if(sp->Enqueue(globalSize, localSize)) // for debugging
-		{
-			if(!program->Finish())
-			{
-				Log::Send(Log::Error, "Error while waiting for subprogram: " + sp->KernelName());
-				return false;
-			}
 
-			return true;
-		}
-		else
+CLSubProgram* Simulation::Subprogram(const std::string& name)
+{
+	std::map<std::string,CLSubProgram*>::iterator found = subprograms.find(name);
+	if(found != subprograms.end())
+		return found->second;
+	return NULL;
+}
+
+
+bool Simulation::EnqueueSubprogram(CLSubProgram* sp, size_t globalSize, size_t localSize)
+{
+	if(!sp)
+	{
+		Log::Send(Log::Error, "Subprogram you want to enqueue doesn't exist");
+		return false;
+	}
+
+	if(!sp->Enqueue(globalSize, localSize))
+	{
+		Log::Send(Log::Error, "Error while executing subprogram: " + sp->KernelName());
+		return false;
+	}
+	return true;
+
+	/*if(sp->Enqueue(globalSize, localSize)) // for debugging
+	{
+		if(!program->Finish())
 		{
-			Log::Send(Log::Error, "Error while executing subprogram: " + sp->KernelName());
+			Log::Send(Log::Error, "Error while waiting for subprogram: " + sp->KernelName());
 			return false;
-		}*/
+		}
 
+		return true;
 	}
-	
-	Log::Send(Log::Error, "Subprogram you want to enqueue doesn't exist");
-	return false;
+	else
+	{
+		Log::Send(Log::Error, "Error while executing subprogram: " + sp->KernelName());
+		return false;
+	}*/
 }
 
 
@@ -240,12 +442,94 @@ CLGlobalBuffer* Simulation::InitSimulationBuffer(const std::string& semantic, Va
 }
 
 
+CLGlobalBuffer* Simulation::InitSortedBuffer(const std::string& semantic)
+{
+	CLGlobalBuffer *unsorted = program->Buffer(semantic);
+	if(!unsorted)
+	{
+		Log::Send(Log::Error, "Cannot keep in cell order nonexistent buffer: " + semantic);
+		return NULL;
+	}
+
+	if(!reorderParticles)
+	{
+		program->ConnectSemantic("SORTED_" + semantic, unsorted);
+		return unsorted;
+	}
+
+	return InitSimulationBuffer("SORTED_" + semantic, unsorted->DataType(), deviceParticleCount);
+}
+
+
+bool Simulation::ReorderBuffer(const std::string& semantic)
+{
+	CLGlobalBuffer *unsorted = program->Buffer(semantic);
+	CLGlobalBuffer *sorted = program->Buffer("SORTED_" + semantic);
+
+	if(!unsorted || !sorted)
+	{
+		Log::Send(Log::Error, "Cannot reorder buffer without its sorted copy: " + semantic);
+		return false;
+	}
+
+	// without reordering, sorted semantic follows the unsorted buffer, which could have been reconnected
+	if(!reorderParticles)
+		return program->ConnectSemantic("SORTED_" + semantic, unsorted);
+
+	return GatherInCellOrder(unsorted, sorted);
+}
+
+
+bool Simulation::ReorderPositions()
+{
+	return GatherInCellOrder(positionsBuffer, program->Buffer("SORTED_POSITIONS"));
+}
+
+
+bool Simulation::EnqueueTiledSubprogram(CLSubProgram* subprogram)
+{
+	return EnqueueSubprogram(subprogram, (gridCellTotal + 1) * TileSize, TileSize);
+}
+
+
+bool Simulation::GatherInCellOrder(CLGlobalBuffer* unsorted, CLGlobalBuffer* sorted)
+{
+	if(unsorted->DataType() == ScalarDataType())
+	{
+		program->ConnectSemantic("REORDER_SCALAR", unsorted);
+		program->ConnectSemantic("SORTED_SCALAR", sorted);
+		return EnqueueSubprogram("reorder scalars");
+	}
+	else if(unsorted->DataType() == VectorDataType())
+	{
+		program->ConnectSemantic("REORDER_VECTOR", unsorted);
+		program->ConnectSemantic("SORTED_VECTOR", sorted);
+		return EnqueueSubprogram("reorder vectors");
+	}
+	else if(unsorted->DataType() == SolverScalarDataType())
+	{
+		program->ConnectSemantic("REORDER_SOLVER_SCALAR", unsorted);
+		program->ConnectSemantic("SORTED_SOLVER_SCALAR", sorted);
+		return EnqueueSubprogram("reorder solver scalars");
+	}
+
+	Log::Send(Log::Error, "Reordering is implemented only for scalar and vector buffers: " + unsorted->Semantic());
+	return false;
+}
+
+
 void Simulation::SetDevices( CLLink* linkToDevices )
 {
 	program->SetLink(linkToDevices);
 }
 
 
+void Simulation::SetProgramCache(const std::string& directory)
+{
+	program->SetBinaryCache(directory);
+}
+
+
 bool Simulation::Initialize()
 {
 	Log::Send(Log::Info, "Initializing the simulation");
@@ -343,21 +627,46 @@ bool Simulation::Initialize()
 		return false;
 	}
 
-	// particle/cell sorter
+	// time steps are uploaded with first advance
+	CLGlobalBuffer* timeSteps = program->Buffer("TIME_STEPS");
+	for(unsigned int i=0; i < TimeStepValueCount; i++)
+		timeSteps->SetScalar(i, 0.0);
+
+	if(neighborLists)
+		program->Buffer("NEIGHBOR_OVERFLOW")->SetScalar(0.0);
+
+	// particle/cell sorter, with keys only as wide as the greatest cell hash needs, so out of grid hash -1 still sorts last.
+	// Sorter takes 4 bits per pass and leaves the result in HASHES only after even number of passes.
+	unsigned int keyBits = 8;
+	while(keyBits < 32 && (gridCellTotal >> keyBits))
+		keyBits += 8;
+	LogDebug("Sorting cell hashes by " + Utils::IntegerString(keyBits) + " bits");
+
 	clppSetup = new clppContext();
 	clppSetup->setup(program->Link()->Platform()->ID(), program->Link()->Device(0)->ID(), program->Link()->Context(), program->Link()->Queue(0));
-	clppSorter = clpp::createBestSortKV(clppSetup, deviceParticleCount, 32);
+	clppSorter = clpp::createBestSortKV(clppSetup, deviceParticleCount, keyBits);
 	clppSorter->pushCLDatas(program->Buffer("HASHES")->Buffer(0), deviceParticleCount);
+	if(incrementalSort)
+	{
+		clppMovedScanner = clpp::createBestScan(clppSetup, sizeof(cl_uint), deviceParticleCount + 1);
+		clppMovedScanner->pushCLDatas(program->Buffer("SORT_MOVED_OFFSETS")->Buffer(0), deviceParticleCount + 1);
+		clppMovedSorter = clpp::createBestSortKV(clppSetup, sortMovedCapacity, keyBits);
+		clppMovedSorter->pushCLDatas(program->Buffer("SORT_MOVED")->Buffer(0), sortMovedCapacity);
+	}
+	hashesSorted = false;
 
 	// precompute tensile correction kernel dP constant
-	EnqueueSubprogram("deltaP", 1, 1);
-	if(!program->Finish())
+	if(Subprogram("deltaP")->IsEnabled())
 	{
-		Log::Send(Log::Error, "Precomputing the tensile correction failed");
-		return false;
+		EnqueueSubprogram("deltaP", 1, 1);
+		if(!program->Finish())
+		{
+			Log::Send(Log::Error, "Precomputing the tensile correction failed");
+			return false;
+		}
+		double dp = 1.0 / program->Buffer("DELTA_P")->GetScalar();
+		program->Argument("DELTA_P_INV")->SetScalar(dp);
 	}
-	double dp = 1.0 / program->Buffer("DELTA_P")->GetScalar();
-	program->Argument("DELTA_P_INV")->SetScalar(dp);
 
 	// setup geometry particles
 	InitGeometry();
@@ -393,15 +702,131 @@ bool Simulation::InitGrid()
 		return false;
 	}
 
+	// Morton code grows with each coordinate, so the last cell has the greatest hash
+	if(mortonCells)
+	{
+		int maxCount = dimensions == 3 ? 1024 : 32768;
+		if(gridCellCount.x > maxCount || gridCellCount.y > maxCount || (dimensions == 3 && gridCellCount.z > maxCount))
+		{
+			Log::Send(Log::Warning, "Grid has too many cells for Morton order. Using row-major order.");
+			mortonCells = false;
+		}
+		else
+		{
+			Vec<3,int> last = gridCellCount - Vec<3,int>(1);
+			unsigned int lastHash = 0;
+			for(unsigned int bit=0; bit<15; bit++)
+				for(unsigned int axis=0; axis<dimensions; axis++)
+					lastHash |= ((unsigned int)(axis == 0 ? last.x : (axis == 1 ? last.y : last.z)) >> bit & 1u) << (bit * dimensions + axis);
+			cells = lastHash + 1;
+			program->AddBuildOption("-D MORTON_CELLS");
+		}
+	}
+
+	gridCellTotal = cells;
+
 	// variables
-	InitSimulationBuffer("CELLS_START", UintType, Utils::NearestMultiple(cells, 1024));
+	if(sparseGrid)
+	{
+		// [start,end) of sorted particles in occupied cells, in hash table at most half full
+		unsigned int tableBits = 10;
+		while((1u << tableBits) < 2 * deviceParticleCount)
+			tableBits++;
+		InitSimulationBuffer("CELL_RANGES", Uint2Type, 1u << tableBits);
+		InitSimulationVariable("CELL_TABLE_SIZE", UintType, 1u << tableBits, true);
+		InitSimulationVariable("CELL_TABLE_BITS", UintType, tableBits, true);
+		program->AddBuildOption("-D SPARSE_GRID");
+	}
+	else
+	{
+		// [start,end) of sorted particles per cell, plus empty one read by extra group of tiled kernels
+		InitSimulationBuffer("CELL_RANGES", Uint2Type, Utils::NearestMultiple(cells + 1, 1024));
+	}
 	InitSimulationBuffer("HASHES", Int2Type, deviceParticleCount);
+	InitSimulationBuffer("SORTED_POSITIONS", VectorDataType(), deviceParticleCount);
 	InitSimulationVariable("GRID_START", VectorDataType(), gridMin, true);
 	InitSimulationVariable("GRID_END", VectorDataType(), gridMax, true);
 	InitSimulationVariable("CELL_SIZE", ScalarDataType(), gridCellSize, true);
 	InitSimulationVariable("CELL_SIZE_INV", ScalarDataType(), 1.0 / gridCellSize, true);
 	InitSimulationVariable("CELL_COUNT", VectorDataType(false), gridCellCount, true);
 	InitSimulationVariable("CELL_COUNT_1", VectorDataType(false), gridCellCount - Vec<3,int>(1), true);
+	InitSimulationVariable("CELL_TOTAL", UintType, cells, true);
+
+	if(reorderParticles)
+		program->AddBuildOption("-D REORDER_PARTICLES");
+
+	// hashes that changed cell are compacted and sorted apart, up to 1/8 of particles
+	if(incrementalSort)
+	{
+		sortMovedCapacity = Utils::NearestMultiple(deviceParticleCount / 8, 1024);
+		InitSimulationBuffer("SORT_MOVED_OFFSETS", UintType, deviceParticleCount + 1);
+		InitSimulationBuffer("SORT_MOVED_COUNT", UintType, 1);
+		InitSimulationBuffer("SORT_MOVED", Int2Type, sortMovedCapacity);
+		InitSimulationBuffer("SORT_STAYED", Int2Type, deviceParticleCount);
+		InitSimulationVariable("SORT_MOVED_CAPACITY", UintType, sortMovedCapacity, true);
+
+		LoadSubprogram("update cell ids",
+		               #include "scene/grid_cellids_update.cl"
+		               );
+		LoadSubprogram("split moved hashes",
+		               #include "scene/grid_sort_split.cl"
+		               );
+		LoadSubprogram("merge moved hashes",
+		               #include "scene/grid_sort_merge.cl"
+		               );
+	}
+
+	// one work-group per cell, that stages neighbors in local memory
+	if(tiledKernels && Devices()->Device(0)->MaxWorkGroupSize() < TileSize)
+	{
+		Log::Send(Log::Warning, "Device work-groups are too small for tiled kernels. Disabling them.");
+		tiledKernels = false;
+	}
+	// clearing only the occupied cells reads all hashes, so it pays off when there are fewer particles than cells
+	clearOccupiedCells = !sparseGrid && deviceParticleCount < gridCellTotal;
+	if(clearOccupiedCells)
+		LogDebug("Clearing only occupied grid cells on refresh");
+
+	if(tiledKernels && sparseGrid)
+	{
+		Log::Send(Log::Warning, "Tiled kernels run over all grid cells, so they can't be used with sparse grid. Disabling them.");
+		tiledKernels = false;
+	}
+	if(tiledKernels)
+	{
+		program->AddBuildOption("-D TILED_KERNELS");
+		program->AddBuildOption("-D TILE_SIZE=" + Utils::IntegerString(TileSize));
+	}
+
+	// Verlet neighbor lists, stored column-wise
+	if(neighborLists)
+	{
+		unsigned int maxNeighbors = NeighborCapacity(gridCellSize);
+
+		InitSimulationBuffer("NEIGHBORS", UintType, maxNeighbors * deviceParticleCount);
+		InitSimulationBuffer("NEIGHBOR_COUNTS", UintType, deviceParticleCount);
+		InitSimulationBuffer("POSITIONS_LISTED", VectorDataType(), deviceParticleCount);
+		InitSimulationBuffer("NEIGHBOR_OVERFLOW", UintType, 1);
+		InitSimulationVariable("MAX_NEIGHBORS", UintType, maxNeighbors, true);
+		InitSimulationVariable("NEIGHBOR_LIST_STRIDE", UintType, deviceParticleCount, true);
+		InitSimulationVariable("NEIGHBOR_SEARCH_SQ", ScalarDataType(), pow(gridCellSize / smoothingLength, 2), true);
+		InitSimulationBuffer("OUT_MAX_DISPLACEMENTS", ScalarDataType(), 2 * Devices()->Device(0)->ComputeUnits());
+		CLLocalBuffer *var = new CLLocalBuffer(program, "LOCAL_MAX_DISPLACEMENTS");  var->SetSpace(ScalarDataType(), 2 * 256);
+		program->AddBuildOption("-D NEIGHBOR_LISTS");
+
+		LoadSubprogram("build neighbor lists",
+		               #include "scene/neighbor_lists_build.cl"
+		               );
+		LoadSubprogram("max displacement",
+		               #include "scene/neighbor_lists_displacement.cl"
+		               );
+	}
+	else
+	{
+		InitSimulationBuffer("NEIGHBORS", UintType, 1); // dummy buffers for kernel args
+		InitSimulationBuffer("NEIGHBOR_COUNTS", UintType, 1);
+	}
+	neighborListsValid = false;
 
 	// subprograms
    LoadSubprogram("grid utils",
@@ -410,12 +835,27 @@ bool Simulation::InitGrid()
    LoadSubprogram("clear grid",
                   #include "scene/grid_clear.cl"
                   );
+   LoadSubprogram("clear occupied cells",
+                  #include "scene/grid_clear_occupied.cl"
+                  , clearOccupiedCells);
    LoadSubprogram("set cell ids",
                   #include "scene/grid_cellids.cl"
                   );
-   LoadSubprogram("set cell start",
+   LoadSubprogram("set cell ranges",
                   #include "scene/grid_cellstart.cl"
                   );
+   LoadSubprogram("reorder scalars",
+                  #include "scene/grid_reorder_scalar.cl"
+                  );
+   LoadSubprogram("reorder vectors",
+                  #include "scene/grid_reorder_vector.cl"
+                  );
+	if(SolverScalarDataType() != ScalarDataType())
+	{
+      LoadSubprogram("reorder solver scalars",
+                     #include "scene/grid_reorder_solver_scalar.cl"
+                     );
+	}
    LoadSubprogram("out of bounds",
                   #include "scene/out_of_bounds.cl"
                   );
@@ -424,6 +864,14 @@ bool Simulation::InitGrid()
 }
 
 
+unsigned int Simulation::NeighborCapacity(double radius)
+{
+	// twice the number of particles that initially fit in radius, to allow for compression and corners
+	double volume = (dimensions == 2 ? M_PI : 4.0 / 3.0 * M_PI) * pow(radius / particleSpacing, (int)dimensions);
+	return Utils::NearestMultiple((unsigned int)ceil(2 * volume), 4);
+}
+
+
 bool Simulation::InitGeneral()
 {
 	if(!smoothingLength)
@@ -445,7 +893,6 @@ bool Simulation::InitGeneral()
 	}
 
 	// Set kernel support radius
-   double supportRadius;
 	switch(smoothingKernel)
 	{
 	case QuadraticKernel:
@@ -462,6 +909,13 @@ bool Simulation::InitGeneral()
 
    gridCellSize = supportRadius;
 
+	// neighbors are searched within larger radius when stored in lists
+	if(neighborLists)
+	{
+		neighborSkin = neighborSkinFactor * supportRadius;
+		gridCellSize += neighborSkin;
+	}
+
 	if(!PreProcessGeometry())
 		return false;
 
@@ -469,6 +923,7 @@ bool Simulation::InitGeneral()
 	timeStepCount = 0;
 	timeOverall = 0;
 	timeStep = 0;
+	timeSynced = true;
 
 	double particleVolume = pow(particleSpacing, (int)dimensions);
 	particleMass[FluidParticle] = particleMass[DummyParticle] = particleVolume * density;
@@ -485,7 +940,7 @@ bool Simulation::InitGeneral()
 
 	InitSimulationVariable("GRAVITY", VectorDataType(), gravity, true);
 
-   InitSimulationVariable("KERNEL_SUPPORT_RADIUSES", VectorDataType(), Vec<3,double>(supportRadius), true);
+   InitSimulationVariable("KERNEL_SUPPORT_RADIUSES", VectorDataType(), Vec<3,double>(gridCellSize), true); // grid search radius
    InitSimulationVariable("KERNEL_SUPPORT_RADIUS", ScalarDataType(), supportRadius, true);
 
 	InitSimulationVariable("SMOOTHING_LENGTH", ScalarDataType(), smoothingLength, true);
@@ -503,17 +958,18 @@ bool Simulation::InitGeneral()
     
 	InitSimulationVariable("DIST_EPSILON", ScalarDataType(), 0.001*(smoothingLength * smoothingLength), true);
 
-	InitSimulationVariable("TIME", ScalarDataType(), 0, false);
-	InitSimulationVariable("TIME_STEP", ScalarDataType(), 0, false);
-	InitSimulationVariable("TIME_STEP_INV", ScalarDataType(), 0, false);
-	InitSimulationVariable("HALF_TIME_STEP", ScalarDataType(), 0, false);
-	InitSimulationVariable("TIME_STEP_6", ScalarDataType(), 0, false);
+	InitSimulationBuffer("TIME_STEPS", ScalarDataType(), TimeStepValueCount);
+	InitSimulationVariable("WANTED_TIME_STEP", ScalarDataType(), 0, false);
+	InitSimulationVariable("CFL_FACTOR", ScalarDataType(), cflFactor, false);
 	InitSimulationBuffer("NEXT_TIME_STEP", ScalarDataType(), 1);
 
 	// local stuff
 	CLLocalBuffer* lvar;
 	lvar = new CLLocalBuffer(program, "LOCAL_SCALAR"); lvar->SetSpace(ScalarDataType(), 1);
 	lvar = new CLLocalBuffer(program, "LOCAL_VECTOR"); lvar->SetSpace(VectorDataType(), 1);
+	lvar = new CLLocalBuffer(program, "LOCAL_SIZE_SCALAR"); lvar->SetSpace(ScalarDataType(), 0);
+	lvar = new CLLocalBuffer(program, "LOCAL_SIZE_VECTOR"); lvar->SetSpace(VectorDataType(), 0);
+	lvar = new CLLocalBuffer(program, "LOCAL_SIZE_CHAR"); lvar->SetSpace(CharType, 0);
 
 	// for tensile correction
 	InitSimulationBuffer("DELTA_P", ScalarDataType(), 1);
@@ -530,6 +986,9 @@ bool Simulation::InitGeneral()
 	else
 		program->AddBuildOption("-D FP=64");
 
+	if(SolverScalarDataType() != ScalarDataType())
+		program->AddBuildOption("-D MIXED_PRECISION");
+
 	// viscosity
 	InitSimulationVariable("VISCOSITY", ScalarDataType(), dynamicViscosity, true);
 	InitSimulationVariable("DYNAMIC_VISCOSITY", ScalarDataType(), dynamicViscosity, true);
@@ -539,52 +998,66 @@ bool Simulation::InitGeneral()
    LoadSubprogram("types",
                   #include "general/types.cl"
                   );
+   LoadSubprogram("time step values",
+                  #include "general/time_step.cl"
+                  );
    LoadSubprogram("max velocity",
                   #include "general/max_vel.cl"
                   );
 	InitSimulationBuffer("OUT_MAX_VELOCITIES", ScalarDataType(), 2 * Devices()->Device(0)->ComputeUnits());
+	InitSimulationVariable("MAX_VELOCITY_PARTIALS", UintType, 2 * Devices()->Device(0)->ComputeUnits(), true);
 	CLLocalBuffer *var = new CLLocalBuffer(program, "LOCAL_MAX_VELOCITIES");  var->SetSpace(ScalarDataType(), 2 * 256);
 
+	std::string kernelSource;
 	switch(smoothingKernel)
 	{
 	case QuadraticKernel:
-      LoadSubprogram("kernel",
+      kernelSource =
                      #include "kernels/quadratic.cl"
-                     );
+                     ;
 		program->AddBuildOption("-D QUADRATIC");
 		break;
 	case CubicSplineKernel:
-      LoadSubprogram("kernel",
+      kernelSource =
                      #include "kernels/cubic.cl"
-                     );
+                     ;
 		program->AddBuildOption("-D CUBIC");
 		break;
 	case QuinticSplineKernel:
-      LoadSubprogram("kernel",
+      kernelSource =
                      #include "kernels/quintic.cl"
-                     );
+                     ;
 		program->AddBuildOption("-D QUINTIC");
 		break;
 	case GaussKernel:
-      LoadSubprogram("kernel",
+      kernelSource =
                      #include "kernels/gauss.cl"
-                     );
+                     ;
 		program->AddBuildOption("-D GAUSS");
 		break;
 	case ModifiedGaussKernel:
-      LoadSubprogram("kernel",
+      kernelSource =
                      #include "kernels/gaussmod.cl"
-                     );
+                     ;
 		program->AddBuildOption("-D GAUSS");
 		break;
 	case WendlandKernel:
-      LoadSubprogram("kernel",
+      kernelSource =
                      #include "kernels/wendland.cl"
-                     );
+                     ;
 		program->AddBuildOption("-D WENDLAND");
 		break;
 	}
 
+	// tabulated kernel is interpolated from samples of analytic one
+	if(tabulatedKernel)
+	{
+		if(!LoadKernelTable())
+			return false;
+	}
+	else
+		LoadSubprogram("kernel", kernelSource);
+
    LoadSubprogram("deltaP",
                   #include "kernels/delta_p.cl"
                   );
@@ -600,19 +1073,125 @@ void Simulation::SetParticleSpacing( double spacing )
 
 
 bool Simulation::RunGrid()
+{
+	// sorter enqueues its own kernels, so replay refreshes the grid from host again
+	return program->RunHostCommand(RefreshGridCommand, this);
+}
+
+
+bool Simulation::RefreshGridCommand(void* simulation)
+{
+	return ((Simulation*)simulation)->RefreshGrid();
+}
+
+
+bool Simulation::RefreshGrid()
 {
 	LogDebug("Refresing uniform grid");
 
-	// clear grid
-	EnqueueSubprogram("clear grid");
-	EnqueueSubprogram("set cell ids");
+	// grid and lists are still valid while no particle has moved more than half of the skin
+	if(neighborLists && neighborListsValid)
+	{
+		// reading displacement waits for devices, so it's checked only as often as particles could reach half of the skin
+		listedRefreshes++;
+		if(listedRefreshes < displacementCheckRefresh)
+			return ReorderPositions();
+
+		double displacement = MaximumDisplacement();
+		double margin = 0.5 * neighborSkin - displacement;
+		if(margin > 0)
+		{
+			// next check before particles moving twice as fast as since the build could use up the margin
+			double refreshesLeft = displacement > 0 ? 0.5 * margin * listedRefreshes / displacement : MaxDisplacementCheckInterval;
+			refreshesLeft = (std::min)(refreshesLeft, (double)MaxDisplacementCheckInterval);
+			displacementCheckRefresh = listedRefreshes + (std::max)(1u, static_cast<unsigned int>(refreshesLeft));
+			return ReorderPositions();
+		}
+	}
+
+	// empty cells occupied in the last refresh while HASHES still hold them, first refresh clears whole grid
+	bool clearOccupied = clearOccupiedCells && hashesSorted;
+	if(clearOccupied)
+		EnqueueSubprogram("clear occupied cells");
 
-	// sort
-	if(clppSorter)
-		clppSorter->sort();
+	bool cellsChanged = true;
+	if(incrementalSort && hashesSorted)
+	{
+		if(!SortMovedHashes(cellsChanged))
+			return false;
+	}
+	else
+	{
+		EnqueueSubprogram("set cell ids");
+
+		// sort
+		if(clppSorter)
+			clppSorter->sort();
+		hashesSorted = true;
+	}
+
+	// set cell ranges, after clearing the grid if occupied cells weren't
+	if(cellsChanged || clearOccupied)
+	{
+		if(!clearOccupied)
+			EnqueueSubprogram("clear grid");
+		EnqueueSubprogram("set cell ranges");
+	}
+
+	// positions in cell order for neighbor loops
+	if(!ReorderPositions())
+		return false;
+
+	if(neighborLists)
+	{
+		if(!EnqueueSubprogram("build neighbor lists"))
+			return false;
 
-	// set cell start
-	EnqueueSubprogram("set cell start");
+		// no step may run with truncated lists, so overflow is read back before any of them is enqueued
+		CLGlobalBuffer* overflow = program->Buffer("NEIGHBOR_OVERFLOW");
+		if(!overflow->Download(true, true))
+			return false;
+		unsigned int overflowCount = static_cast<unsigned int>(overflow->GetScalar());
+		if(overflowCount)
+		{
+			Log::Send(Log::Error, "Particle has " + Utils::IntegerString(overflowCount) + " neighbors, more than neighbor lists can hold ("
+				+ Utils::IntegerString(NeighborCapacity(gridCellSize)) + "). Disable neighbor lists for this simulation.");
+			return false;
+		}
+
+		neighborListsValid = true;
+		listedRefreshes = 0;
+		displacementCheckRefresh = 1;
+	}
+
+	return true;
+}
+
+
+bool Simulation::SortMovedHashes(bool& cellsChanged)
+{
+	// new hashes in the last sorted order, compacted by whether they changed
+	EnqueueSubprogram("update cell ids");
+	clppMovedScanner->scan();
+	EnqueueSubprogram("split moved hashes");
+
+	// host waits only for the count, while devices sort whole padded list and merge it
+	CLGlobalBuffer* count = program->Buffer("SORT_MOVED_COUNT");
+	if(!count->Download(false, true))
+		return false;
+	clppMovedSorter->sort();
+	if(!EnqueueSubprogram("merge moved hashes"))
+		return false;
+	unsigned int moved = static_cast<unsigned int>(count->GetScalar());
+
+	cellsChanged = moved > 0;
+
+	// hashes that didn't fit kept their old cells, so sort all of them again
+	if(moved > sortMovedCapacity)
+	{
+		EnqueueSubprogram("set cell ids");
+		clppSorter->sort();
+	}
 
 	return true;
 }
@@ -628,6 +1207,12 @@ void RunNewExportThread(void* exporterData)
 
 
 bool Simulation::Advance( double advanceTimeStep )
+{
+	return AdvanceMany(1, advanceTimeStep);
+}
+
+
+bool Simulation::AdvanceMany(unsigned int steps, double advanceTimeStep)
 {
 	LogDebug("Advancing simulation");
 
@@ -637,7 +1222,10 @@ bool Simulation::Advance( double advanceTimeStep )
 		return false;
 	}
 
-	if(Time() < DBL_EPSILON)
+	if(!steps)
+		return true;
+
+	if(!timeStepCount)
 	{
 		for(std::list<Writer*>::iterator i = exporters.begin(); i != exporters.end(); i++)
 		{
@@ -646,7 +1234,7 @@ bool Simulation::Advance( double advanceTimeStep )
 		}
 	}
 
-	// for profiling this time step
+	// for profiling these time steps
 	timer.Start();
 
 	// upload particle data if it changed
@@ -656,32 +1244,90 @@ bool Simulation::Advance( double advanceTimeStep )
 		return false;
 	}
 
-	// update time step vars
-	timeStep = advanceTimeStep;
-	program->Argument("TIME_STEP")->SetScalar(timeStep);
-	program->Argument("TIME_STEP_INV")->SetScalar(1.0 / timeStep);
-	program->Argument("HALF_TIME_STEP")->SetScalar(timeStep / 2.0);
-	program->Argument("TIME_STEP_6")->SetScalar(timeStep / 6.0);
+	// choose time step on devices, so they don't wait for host
+	bool automaticTimeStep = advanceTimeStep < DBL_EPSILON;
+	program->Argument("WANTED_TIME_STEP")->SetScalar(automaticTimeStep ? 0.0 : advanceTimeStep);
 
-	// move objects if needed
-	for(std::multimap<std::string,Geometry*>::iterator it=models.begin(); it != models.end(); it++)
-		if(it->second->ExpressionMovement())
+	// record the first step, and replay it while host would enqueue the same commands
+	bool canReplay = false;
+	unsigned int recordedVariant = 0;
+	std::vector<Geometry*> recordedMovements, movements;
+
+	for(unsigned int step=0; step < steps; step++)
+	{
+		ActiveMovements(movements);
+
+		if(canReplay && recordedVariant == StepVariant() && recordedMovements == movements)
 		{
-			if(timeOverall >= it->second->startMovementTime && (timeOverall <= it->second->endMovementTime || it->second->endMovementTime < DBL_EPSILON))
-			EnqueueSubprogram("move_" + it->second->Name(), Utils::NearestMultiple(it->second->ParticleCount(), 256), 256);
+			if(!program->Replay())
+				return false;
 		}
+		else
+		{
+			if(steps > 1)
+				program->StartRecording();
+
+			bool success = EnqueueStep(automaticTimeStep, movements);
+
+			if(steps > 1)
+			{
+				canReplay = program->StopRecording() && success;
+				recordedVariant = StepVariant();
+				recordedMovements = movements;
+			}
+
+			if(!success)
+				return false;
+		}
+
+		if(!FinishStep(automaticTimeStep, advanceTimeStep))
+			return false;
+	}
+
+	// profile a time step
+	timeStepTimer = timer.Time() / steps;
+	
+	return true;
+}
+
+
+bool Simulation::EnqueueStep(bool automaticTimeStep, const std::vector<Geometry*>& movements)
+{
+	if(!EnqueueTimeStep(automaticTimeStep))
+		return false;
+
+	// move objects if needed
+	for(size_t i=0; i<movements.size(); i++)
+		EnqueueSubprogram("move_" + movements[i]->Name(), Utils::NearestMultiple(movements[i]->ParticleCount(), 256), 256);
 
 	// run the SPH simulation on devices
 	if(!RunSph())
 		return false;
 
-	if(!EnqueueSubprogram("out of bounds"))
-		return false;
+	return EnqueueSubprogram("out of bounds");
+}
+
 
+bool Simulation::FinishStep(bool automaticTimeStep, double advanceTimeStep)
+{
 	// advance sim time
-	timeOverall += advanceTimeStep; 
-	program->Argument("TIME")->SetScalar(timeOverall);
 	timeStepCount++;
+	if(!automaticTimeStep && timeSynced)
+	{
+		timeStep = advanceTimeStep;
+		timeOverall += advanceTimeStep;
+	}
+	else if(automaticTimeStep && timeStepCount % timeSyncInterval)
+	{
+		// time is unknown to host, nothing to check
+		timeSynced = false;
+		return true;
+	}
+	else if(!SyncTime())
+	{
+		Log::Send(Log::Error, "Failed to read time step from devices.");
+		return false;
+	}
 
 	// auto manage export
 	for(std::list<Writer*>::iterator i = exporters.begin(); i != exporters.end(); i++)
@@ -707,9 +1353,43 @@ bool Simulation::Advance( double advanceTimeStep )
 		}
 	}
 
-	// profile this time step
-	timeStepTimer = timer.Time();
-	
+	return true;
+}
+
+
+void Simulation::ActiveMovements(std::vector<Geometry*>& movements)
+{
+	movements.clear();
+	for(std::multimap<std::string,Geometry*>::iterator it=models.begin(); it != models.end(); it++)
+		if(it->second->ExpressionMovement())
+		{
+			if(timeOverall >= it->second->startMovementTime && (timeOverall <= it->second->endMovementTime || it->second->endMovementTime < DBL_EPSILON))
+				movements.push_back(it->second);
+		}
+}
+
+
+unsigned int Simulation::StepVariant()
+{
+	return 0;
+}
+
+
+bool Simulation::EnqueueTimeStep(bool /*automatic*/)
+{
+	return EnqueueSubprogram("time step", 1, 1);
+}
+
+
+bool Simulation::SyncTime()
+{
+	CLGlobalBuffer* timeSteps = program->Buffer("TIME_STEPS");
+	if(!timeSteps->Download(true, true))
+		return false;
+
+	timeStep = timeSteps->GetScalar(TimeStepDt);
+	timeOverall = timeSteps->GetScalar(TimeStepTime) + timeSteps->GetScalar(TimeStepTimeRest) + timeStep;
+	timeSynced = true;
 	return true;
 }
 
@@ -727,7 +1407,10 @@ bool Simulation::UploadModifiedBuffers()
 
 	// since we changed particles, refresh the grid
 	if(success && positionsHaveChanged)
+	{
+		neighborListsValid = false;
 		success &= RunGrid();
+	}
 
 	return success;
 }
@@ -799,6 +1482,12 @@ VariableDataType Simulation::ScalarDataType()
 	return scalarType;
 }
 
+
+VariableDataType Simulation::SolverScalarDataType()
+{
+	return mixedPrecision ? FloatType : scalarType;
+}
+
 void Simulation::SetName(const std::string& simName)
 {
 	name = simName;
@@ -818,18 +1507,13 @@ CLLink* Simulation::Devices()
 
 bool Simulation::Run()
 {
+	program->Argument("CFL_FACTOR")->SetScalar(cflFactor);
+
+	// host checks time only when it is read back, so advance that many steps at once
 	while(Time() < maxTime)
 	{
-		if(wantedTimeStep > DBL_EPSILON)
-		{
-			if(!Advance(wantedTimeStep))
-				return false;
-		}
-		else
-		{
-			if(!Advance(cflFactor * SuggestTimeStep()))
-				return false;
-		}
+		if(!AdvanceMany(timeSyncInterval, wantedTimeStep > DBL_EPSILON ? wantedTimeStep : 0.0))
+			return false;
 	}
 	Finish();
 	return true;
@@ -842,11 +1526,65 @@ void Simulation::SetRunTime(double time, double timeStep, double autoFactor)
 	cflFactor = autoFactor;
 }
 
+void Simulation::SetTimeSyncInterval(unsigned int interval)
+{
+	timeSyncInterval = interval ? interval : 1;
+}
+
 void Simulation::SetAsyncExport( bool enabled )
 {
 	asyncExport = enabled;
 }
 
+void Simulation::SetParticleReordering( bool enabled )
+{
+	reorderParticles = enabled;
+}
+
+void Simulation::SetMortonCellOrder( bool enabled )
+{
+	mortonCells = enabled;
+}
+
+void Simulation::SetSparseGrid( bool enabled )
+{
+	sparseGrid = enabled;
+}
+
+void Simulation::SetIncrementalSort( bool enabled )
+{
+	incrementalSort = enabled;
+}
+
+void Simulation::SetTiledKernels( bool enabled )
+{
+	tiledKernels = enabled;
+}
+
+void Simulation::SetMixedPrecision( bool enabled )
+{
+	if(enabled && scalarType != DoubleType)
+	{
+		Log::Send(Log::Warning, "Mixed precision solver is meant for double precision simulations. Ignoring it.");
+		enabled = false;
+	}
+
+	mixedPrecision = enabled;
+}
+
+void Simulation::SetNeighborLists( bool enabled, double skinFactor )
+{
+	neighborLists = enabled;
+
+	if(skinFactor <= 0)
+	{
+		Log::Send(Log::Warning, "Neighbor list skin has to be positive. Setting to 0.1.");
+		neighborSkinFactor = 0.1;
+	}
+	else
+		neighborSkinFactor = skinFactor;
+}
+
 void Simulation::Finish()
 {
 	for(std::list<Writer*>::iterator i = exporters.begin(); i != exporters.end(); i++)
@@ -884,6 +1622,25 @@ double Simulation::MaximumVelocity()
 	return sqrt(maxVel);
 }
 
+double Simulation::MaximumDisplacement()
+{
+	CLGlobalBuffer* out = program->Buffer("OUT_MAX_DISPLACEMENTS");
+
+	// enqueue reduction kernel and get the result
+	int localSize = Devices()->Device(0)->IsCPU() ? 1 : 256;
+	if(!this->EnqueueSubprogram("max displacement", localSize * out->Elements(), localSize))
+		return DBL_MAX;
+	if(!out->Download(false, true))
+		return DBL_MAX;
+
+	// get maximum from downloaded data, waiting only for its read
+	double maxDisp = 0.0;
+	for(size_t i=0; i < out->Elements(); i++)
+		maxDisp = (std::max)(maxDisp, out->GetScalar(i));
+
+	return sqrt(maxDisp);
+}
+
 struct QueuedParticle 
 {
 	int xMin, xMax, y, upDownDir;
@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <vector>
 #include "particle.h"
 #include "geometry.h"
 #include "extern/tinythread/tinythread.h"
@@ -11,6 +12,7 @@
 
 class clppContext;
 class clppSort;
+class clppScan;
 
 /*!
  *	\namespace	isph
@@ -35,6 +37,21 @@ namespace isph {
 		ModifiedGaussKernel	//!< Modified Gauss' (exponential based) smoothing kernel takes into account compact support.
 	};
 
+	/*!
+	 *	\enum	TimeStepValue
+	 *	\brief	Indices of values in TIME_STEPS buffer, same as in general/time_step.cl.
+	 */
+	enum TimeStepValue
+	{
+		TimeStepDt,			//!< Current time step.
+		TimeStepDtInv,		//!< Inverse of current time step.
+		TimeStepHalfDt,		//!< Half of current time step.
+		TimeStepDt6,		//!< Sixth of current time step.
+		TimeStepTime,		//!< Simulation time at start of current time step, in whole time quanta.
+		TimeStepTimeRest,	//!< Rest of simulation time, less than a time quantum plus current time step.
+		TimeStepValueCount
+	};
+
 
 	/*!
 	 *	\class	Simulation
@@ -124,6 +141,18 @@ namespace isph {
 		 */
 		inline bool SmoothingKernelCorrection() { return smoothingKernelCorrection; }
 
+		/*!
+		 *	\brief	Set if smoothing kernel and its gradient are interpolated from tables sampled at initialization.
+		 *	\param	enabled	Use tabulated kernel. Default is false.
+		 *	\param	samples	Number of table intervals over squared kernel support.
+		 */
+		void SetTabulatedKernel(bool enabled, unsigned int samples = 2048);
+
+		/*!
+		 *	\brief	Is smoothing kernel interpolated from tables.
+		 */
+		inline bool TabulatedKernel() { return tabulatedKernel; }
+
 		/*!
 		 *	\brief	Define where to start applying bucket fill.
 		 */
@@ -190,6 +219,11 @@ namespace isph {
 		 */
 		CLLink* Devices();
 
+		/*!
+		 *	\brief	Set directory where compiled program binaries are cached between runs. Empty (default) disables it.
+		 */
+		void SetProgramCache(const std::string& directory);
+
 		/*!
 		 *	\brief	Initialize the simulation with all the parameters set.
 		 *	\return	Success.
@@ -198,11 +232,23 @@ namespace isph {
 
 		/*!
 		 *	\brief	Advance simulation by specified time step, in seconds.
-		 *	\param	advanceTimeStep	Time step to advance simulation by, in seconds.
+		 *	\param	advanceTimeStep	Time step to advance simulation by, in seconds. Zero to let devices choose it from CFL and viscous conditions.
 		 *	\return	Success.
 		 */
 		virtual bool Advance(double advanceTimeStep);
 
+		/*!
+		 *	\brief	Advance simulation by many time steps, each by specified time step, in seconds.
+		 *	\param	steps	Number of time steps to make.
+		 *	\param	advanceTimeStep	Time step to advance simulation by, in seconds. Zero to let devices choose it.
+		 *	\return	Success.
+		 *
+		 *	Commands of the first time step are recorded, and replayed for the next ones, without host logic
+		 *	of the SPH method, until its variant or moving objects change. Steps where host reads device data
+		 *	(e.g. iterative solvers checking convergence) can't be replayed, and run as with Advance().
+		 */
+		bool AdvanceMany(unsigned int steps, double advanceTimeStep = 0.0);
+
 		/*!
 		 *	\brief	Wait all enqueued computations to finish.
 		 */
@@ -215,6 +261,11 @@ namespace isph {
 		 */
 		double MaximumVelocity();
 
+		/*!
+		 *	\brief	Get the maximum displacement of particles since neighbor lists were built.
+		 */
+		double MaximumDisplacement();
+
 		/*!
 		 *	\brief	Suggest next time step based on CFL and viscous conditions.
 		 *	\return	Time in seconds.
@@ -224,11 +275,26 @@ namespace isph {
 		/*!
 		 *	\brief	Set simulation runtime parameters.
 		 *	\param	time	Overall time, in seconds, to run simulation.
-		 *	\param	timeStep	Time steps to advance simulation by, in seconds. Leave as zero for automatic time stepping with function SuggestTimeStep().
+		 *	\param	timeStep	Time steps to advance simulation by, in seconds. Leave as zero for automatic time stepping, computed on devices.
 		 *	\param	autoFactor	Factor that multiplies with automatically suggested time steps.
 		 */
 		void SetRunTime(double time, double timeStep = 0.0, double autoFactor = 1.0);
 
+		/*!
+		 *	\brief	Set how often, in time steps, automatically chosen time step is read back from devices. Default is 10.
+		 *
+		 *	Between reads, time steps are enqueued without waiting for devices, so Time() lags behind
+		 *	by up to interval-1 time steps. Exporting, movement start and end time checks only happen
+		 *	at time steps that read it back, so they can come that many steps late, and Run() can pass
+		 *	its run time by as many. Set 1 to read time back every time step.
+		 */
+		void SetTimeSyncInterval(unsigned int interval);
+
+		/*!
+		 *	\brief	Get how often, in time steps, automatically chosen time step is read back from devices.
+		 */
+		inline unsigned int TimeSyncInterval() { return timeSyncInterval; }
+
 		/*!
 		 *	\brief	Run the simulation for a while, automatically export simulated data.
 		 */
@@ -278,6 +344,102 @@ namespace isph {
 		 */
 		inline bool AsyncExport() { return asyncExport; }
 
+		/*!
+		 *	\brief	Set if particle attributes read by neighbor loops should be kept in cell order. Default is false.
+		 *
+		 *	Positions are always gathered into cell order after the grid is refreshed. When enabled, other attributes
+		 *	that the SPH method reads from neighbors are gathered too, so neighbor loops read coalesced memory,
+		 *	at the cost of extra buffers and a gather pass for each. Attributes indexed by particle id are unaffected.
+		 */
+		void SetParticleReordering(bool enabled);
+
+		/*!
+		 *	\brief	Get if particle attributes read by neighbor loops are kept in cell order.
+		 */
+		inline bool ParticleReordering() { return reorderParticles; }
+
+		/*!
+		 *	\brief	Set if grid cells are hashed in Z-order (Morton) instead of row-major order. Default is false.
+		 *
+		 *	Particles sorted by cell hash are then close in memory when close in space along any axis,
+		 *	not only along x. Grid can have at most 1024 cells per axis in 3D, and 32768 in 2D.
+		 */
+		void SetMortonCellOrder(bool enabled);
+
+		/*!
+		 *	\brief	Get if grid cells are hashed in Z-order (Morton).
+		 */
+		inline bool MortonCellOrder() { return mortonCells; }
+
+		/*!
+		 *	\brief	Set if cell ranges are kept in hash table of occupied cells, instead of for every grid cell. Default is false.
+		 *
+		 *	Memory and clearing of the grid then grow with particle count, not with volume of the domain,
+		 *	which suits large domains that are mostly empty. Each neighbor cell costs a table lookup.
+		 *	Tiled kernels can't be used with it.
+		 */
+		void SetSparseGrid(bool enabled);
+
+		/*!
+		 *	\brief	Get if cell ranges are kept in hash table of occupied cells.
+		 */
+		inline bool SparseGrid() { return sparseGrid; }
+
+		/*!
+		 *	\brief	Set if grid refresh sorts only particles that changed cell since the last sort. Default is false.
+		 *
+		 *	Hashes are kept in the last sorted order, particles that changed cell are sorted apart and merged
+		 *	with the rest. Refresh with no particle changing cell skips the sort and cell ranges altogether.
+		 *	When more than 1/8 of particles changed cell, all are sorted as usual.
+		 */
+		void SetIncrementalSort(bool enabled);
+
+		/*!
+		 *	\brief	Get if grid refresh sorts only particles that changed cell since the last sort.
+		 */
+		inline bool IncrementalSort() { return incrementalSort; }
+
+		/*!
+		 *	\brief	Set if neighbor kernels that support it run tiled, one work-group per grid cell. Default is false.
+		 *
+		 *	Work-group stages particles of neighbor cells to local memory, and its particles read them from there,
+		 *	so neighbors are read from global memory once per cell instead of once per particle.
+		 */
+		void SetTiledKernels(bool enabled);
+
+		/*!
+		 *	\brief	Get if neighbor kernels that support it run tiled, one work-group per grid cell.
+		 */
+		inline bool TiledKernels() { return tiledKernels; }
+
+		/*!
+		 *	\brief	Set if linear solver iterates in single precision inside of double precision simulation. Default is false.
+		 *
+		 *	Solver vectors and matrix are stored in float, while pressure, right hand side and residual of outer
+		 *	iterative refinement stay in double. Has no effect in single precision simulations.
+		 */
+		void SetMixedPrecision(bool enabled);
+
+		/*!
+		 *	\brief	Get if linear solver iterates in single precision inside of double precision simulation.
+		 */
+		inline bool MixedPrecision() { return mixedPrecision; }
+
+		/*!
+		 *	\brief	Set if neighbors should be stored in Verlet lists, instead of searching the grid in each kernel. Default is false.
+		 *	\param	enabled		Choose whether to enable or disable neighbor lists.
+		 *	\param	skinFactor	Skin added to the kernel support radius, as a fraction of it. Default is 0.1.
+		 *
+		 *	Lists are built with support radius plus skin, and reused across kernels and time steps, until some
+		 *	particle has moved more than half of the skin. Then the grid is refreshed and lists are rebuilt.
+		 */
+		void SetNeighborLists(bool enabled, double skinFactor = 0.1);
+
+		/*!
+		 *	\brief	Get if neighbors are stored in Verlet lists.
+		 */
+		inline bool NeighborLists() { return neighborLists; }
+
 		/*!
 		 *	\brief	Get OpenCL program associated with solver.
 		 */
@@ -313,6 +475,11 @@ namespace isph {
 		 */
 		VariableDataType ScalarDataType();
 
+		/*!
+		 *	\brief	Get the scalar data type of linear solver vectors.
+		 */
+		VariableDataType SolverScalarDataType();
+
 	protected:
 
 		/*!
@@ -343,19 +510,73 @@ namespace isph {
 
 		/*!
 		 *	\brief	Load a subprogram from .CL file, and set a name for it.
+		 *	\param	reachable	Set to false if chosen configuration never enqueues it, so it isn't compiled.
 		 */
-      bool LoadSubprogram(const std::string& name, const std::string& source);
+      bool LoadSubprogram(const std::string& name, const std::string& source, bool reachable = true);
 
 		/*!
 		 *	\brief	Execute subprogram.
 		 */
 		bool EnqueueSubprogram(const std::string& name, size_t globalSize=0, size_t localSize=0);        
 
+		/*!
+		 *	\brief	Get loaded subprogram by its name, NULL if it doesn't exist.
+		 *	\remarks Resolve subprograms once, for the ones enqueued many times per time step.
+		 */
+		CLSubProgram* Subprogram(const std::string& name);
+
+		/*!
+		 *	\brief	Execute subprogram, already resolved by its name.
+		 */
+		bool EnqueueSubprogram(CLSubProgram* subprogram, size_t globalSize=0, size_t localSize=0);
+
+		/*!
+		 *	\brief	Enqueue choosing of next time step into TIME_STEPS buffer.
+		 *	\param	automatic	If true, choose it from simulation state, else use WANTED_TIME_STEP.
+		 */
+		virtual bool EnqueueTimeStep(bool automatic);
+
+		/*!
+		 *	\brief	Read time step and time back from devices.
+		 */
+		bool SyncTime();
+
 		/*!
 		 *	\brief	Insert all particles to grid.
 		 */
 		virtual bool RunGrid();
 
+		/*!
+		 *	\brief	Refresh grid and neighbor lists, with particles at current positions.
+		 */
+		bool RefreshGrid();
+
+		/*!
+		 *	\brief	Host command that refreshes grid of simulation, when replaying recorded time step.
+		 */
+		static bool RefreshGridCommand(void* simulation);
+
+		/*!
+		 *	\brief	Enqueue all work of one time step.
+		 *	\param	movements	Objects with expression movement to move in this time step.
+		 */
+		bool EnqueueStep(bool automaticTimeStep, const std::vector<Geometry*>& movements);
+
+		/*!
+		 *	\brief	Advance time after enqueued time step, and export simulated data if needed.
+		 */
+		bool FinishStep(bool automaticTimeStep, double advanceTimeStep);
+
+		/*!
+		 *	\brief	Get objects that move by expression at current time.
+		 */
+		void ActiveMovements(std::vector<Geometry*>& movements);
+
+		/*!
+		 *	\brief	Get variant of next time step, different when SPH method enqueues different commands for it.
+		 */
+		virtual unsigned int StepVariant();
+
 		/*!
 		 *	\brief	Create boolean simulation property to use it in OpenCL programs
 		 */
@@ -376,6 +597,60 @@ namespace isph {
 		 */
 		CLGlobalBuffer* InitSimulationBuffer(const std::string& semantic, VariableDataType dataType, unsigned int elementCount);
 
+		/*!
+		 *	\brief	Init copy of particle attribute, with semantic prefixed by SORTED_, that neighbor loops read in cell order.
+		 *
+		 *	If particle reordering is disabled, no buffer is created, and the semantic is connected to the unsorted buffer.
+		 */
+		CLGlobalBuffer* InitSortedBuffer(const std::string& semantic);
+
+		/*!
+		 *	\brief	Gather particle attribute into its SORTED_ buffer, in order of the last grid refresh.
+		 */
+		bool ReorderBuffer(const std::string& semantic);
+
+		/*!
+		 *	\brief	Gather positions into SORTED_POSITIONS buffer, that neighbor loops always read.
+		 */
+		bool ReorderPositions();
+
+		/*!
+		 *	\brief	Sort hashes of particles that changed cell and merge them with the rest, still in the last sorted order.
+		 *	\param	cellsChanged	Set to false when no particle changed cell, so cell ranges are still valid.
+		 *	\remarks Sorts all hashes again, when more moved than padded moved list holds.
+		 */
+		bool SortMovedHashes(bool& cellsChanged);
+
+		/*!
+		 *	\brief	Gather buffer into other buffer, in order of the last grid refresh.
+		 */
+		bool GatherInCellOrder(CLGlobalBuffer* unsorted, CLGlobalBuffer* sorted);
+
+		/*!
+		 *	\brief	Execute tiled neighbor subprogram, with one work-group per grid cell and one more for particles out of grid.
+		 */
+		bool EnqueueTiledSubprogram(CLSubProgram* subprogram);
+
+		/*!
+		 *	\brief	Analytic smoothing kernel, same as in kernel .cl files, at squared distance relative to smoothing length.
+		 */
+		double KernelValue(double qSq);
+
+		/*!
+		 *	\brief	Analytic smoothing kernel gradient divided by distance vector, same as in kernel .cl files.
+		 */
+		double KernelGradientFactor(double qSq);
+
+		/*!
+		 *	\brief	Sample kernel and gradient tables, check interpolation error and load them as subprogram.
+		 */
+		bool LoadKernelTable();
+
+		/*!
+		 *	\brief	Get the maximum number of neighbors to reserve per particle, for neighbors within radius.
+		 */
+		unsigned int NeighborCapacity(double radius);
+
 		/*!
 		 *	\brief	Init general simulation subprograms, variables and build options.
 		 */
@@ -452,6 +727,7 @@ namespace isph {
 
 		// allocation info
 		VariableDataType scalarType;
+		bool mixedPrecision;
 		unsigned int dimensions;
 
 		// solver
@@ -483,6 +759,9 @@ namespace isph {
 		SmoothingKernelType smoothingKernel;
 		double smoothingLength;
 		bool smoothingKernelCorrection;
+		double supportRadius;
+		bool tabulatedKernel;
+		unsigned int kernelTableSamples;
 	
 		// density & viscosity
 		double density;
@@ -501,6 +780,27 @@ namespace isph {
 		Vec<3,int> gridCellCount;
 		clppContext* clppSetup;
 		clppSort* clppSorter;
+		clppScan* clppMovedScanner;
+		clppSort* clppMovedSorter;
+		bool reorderParticles;
+		bool mortonCells;
+		bool sparseGrid;
+		bool incrementalSort;
+		bool hashesSorted;
+		bool clearOccupiedCells;
+		unsigned int sortMovedCapacity;
+		bool tiledKernels;
+		unsigned int gridCellTotal;
+		static const unsigned int TileSize = 64; // work items per cell in tiled kernels
+
+		// neighbor lists
+		bool neighborLists;
+		double neighborSkinFactor;
+		double neighborSkin;
+		bool neighborListsValid;
+		unsigned int listedRefreshes; // grid refreshes since neighbor lists were built
+		unsigned int displacementCheckRefresh; // refresh that reads displacement back again
+		static const unsigned int MaxDisplacementCheckInterval = 10;
 
 		// time
 		double maxTime;
@@ -509,6 +809,8 @@ namespace isph {
 		double timeStep;
 		double cflFactor;
 		unsigned int timeStepCount;
+		unsigned int timeSyncInterval;
+		bool timeSynced;
 		double timeStepTimer;
 		Timer timer;
 
@@ -11,7 +11,7 @@ __kernel void MLSPost
 	__global scalar *densityS : SORTED_DENSITIES,
 	__global scalar *mass : SORTED_MASSES,
 	__global const vector *pos : SORTED_POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	uint particleCount : PARTICLE_COUNT
 )
@@ -84,7 +84,7 @@ __kernel void MLSPost
 	
 	// Correct density as integral of neighboring masses with corrected kernel
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,pos,posI)
 #if DIM == 2
         scalar W = (beta0 + (beta1 * posDif.x) + (beta2 * posDif.y)) * SphKernel(QSq);
 #endif		
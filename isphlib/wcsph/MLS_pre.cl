@@ -10,7 +10,7 @@ __kernel void MLSPre
 	__global const scalar *density : SORTED_DENSITIES,
 	__global const scalar *mass : SORTED_MASSES,
 	__global const vector *pos : SORTED_POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	uint particleCount : PARTICLE_COUNT
 )
@@ -28,7 +28,7 @@ __kernel void MLSPre
 	
 	// Add contribution to MLS matrix terms from neighboring particles
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,pos,posI)
 	    scalar W = SphKernel(QSq) * mass[_j] / density[_j];
 	    tmp_1.x += W;                     //A(1,1)
 	    tmp_1.y += posDif.x * W;               //A(1,2)
@@ -14,7 +14,7 @@ __kernel void Accelerations
 	__global const scalar *density	: SORTED_DENSITIES,
 	__global const scalar *mass		: SORTED_MASSES,
 	__global const scalar *pods		: PODS,
-	__global const uint *cellsStart	: CELLS_START,
+	__global const uint2 *cellRanges	: CELL_RANGES,
 	__global const int2 *hashes		: HASHES,
 	uint fluidParticleCount			: FLUID_PARTICLE_COUNT,
 	scalar deltaPKernelInv			: DELTA_P_INV
@@ -44,7 +44,7 @@ __kernel void Accelerations
 	vector corr = (vector)0;
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,pos,posI)
 
 		scalar massJ = mass[_j];
 		scalar podsJ = pods[_j];
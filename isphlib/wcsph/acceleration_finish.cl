@@ -0,0 +1,32 @@
+/*!
+ *	\brief	Finish accelerations and XSPH velocities from sums of pair-wise kernel, and clear the sums
+ */
+__kernel void AccelerationsFinish
+(
+	__global vector *xsphVel 		: XSPH_VELOCITIES,
+	__global vector *xsphVelS 		: XSPH_SORTED,
+	__global vector *acc			: ACCELERATIONS,
+	__global vector *pairAcc		: PAIR_ACCELERATIONS,
+	__global vector *pairCorr		: PAIR_XSPH_CORRECTIONS,
+	__global const vector *vel		: SORTED_VELOCITIES,
+	__global const int2 *hashes		: HASHES,
+	uint fluidParticleCount			: FLUID_PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	uint unsorted = hashes[i].y;
+	if(unsorted >= fluidParticleCount)
+	{
+		xsphVelS[i] = vel[i];
+		return;
+	}
+
+	acc[unsorted] = pairAcc[unsorted] + GRAVITY;
+	vector xsph = vel[i] - 2 * XSPH_FACTOR * pairCorr[unsorted];
+	xsphVelS[i] = xsph;
+	xsphVel[unsorted] = xsph;
+
+	// cleared for the next derivatives
+	pairAcc[unsorted] = (vector)0;
+	pairCorr[unsorted] = (vector)0;
+}
@@ -0,0 +1,94 @@
+/*!
+ *	\brief	Acceleration and XSPH correction terms of each particle pair computed once, and added to both fluid particles
+ *
+ *	Runs over particles in cell order. Accelerations finish kernel reads the sums and clears them.
+ */
+__kernel void AccelerationPairs
+(
+	__global vector *pairAcc		: PAIR_ACCELERATIONS,
+	__global vector *pairCorr		: PAIR_XSPH_CORRECTIONS,
+	__global const vector *vel		: SORTED_VELOCITIES,
+	__global const vector *pos		: SORTED_POSITIONS,
+	__global const scalar *density	: SORTED_DENSITIES,
+	__global const scalar *mass		: SORTED_MASSES,
+	__global const scalar *pods		: PODS,
+	__global const uint2 *cellRanges	: CELL_RANGES,
+	__global const int2 *hashes		: HASHES,
+	uint particleCount				: PARTICLE_COUNT,
+	uint fluidParticleCount			: FLUID_PARTICLE_COUNT,
+	scalar deltaPKernelInv			: DELTA_P_INV
+)
+{
+	size_t _i = get_global_id(0);
+	if(_i >= particleCount) return;
+
+	int i = hashes[_i].y;
+	bool fluidI = (uint)i < fluidParticleCount;
+	vector posI = pos[_i];
+	vector velI = vel[_i];
+	scalar densityI = density[_i];
+	scalar massI = mass[_i];
+	scalar podsI = pods[_i];
+	scalar tensileI = podsI * (podsI<0 ? TC_EPSILON1 : TC_EPSILON2);
+
+#if VISCOSITY_FORMULATION == 1 // ARTIFICIAL
+	scalar csI = densityI * DENSITY_INV;
+	csI *= WC_SOUND_SPEED * csI * csI;
+#endif
+	vector aI = (vector)0;
+	vector corrI = (vector)0;
+
+	ForEachSetup(posI)
+	ForEachPairNeighbor(hashes,cellRanges,pos,posI)
+
+		bool fluidJ = (uint)j < fluidParticleCount;
+		if(fluidI || fluidJ)
+		{
+			scalar massJ = mass[_j];
+			scalar podsJ = pods[_j];
+			vector velDif = velI - vel[_j];
+			scalar W = SphKernel(QSq);
+			vector gradW = SphKernelGrad(QSq, posDif);
+
+			// tensile correction, Monaghan JCP 2000
+			scalar f = W * deltaPKernelInv;
+			f *= f; f *= f; // (Wij/Wdp)^4
+			scalar tensileJ = podsJ * (podsJ<0 ? TC_EPSILON1 : TC_EPSILON2);
+			scalar tensile  = podsI<0 ? tensileI : 0;
+			tensile += podsJ<0 ? tensileJ : 0;
+			tensile += (podsI>0 && podsJ>0) ? tensileI + tensileJ : 0;
+
+			// pair term without mass of the other particle, j gets it with opposite sign
+		#if VISCOSITY_FORMULATION == 1 // ARTIFICIAL (Monaghan 1994)
+			scalar densityJ = density[_j];
+			scalar densityAdd = 1 / (densityI + densityJ);
+			scalar csJ = densityJ * DENSITY_INV;
+			csJ *= WC_SOUND_SPEED * csJ * csJ;
+			scalar phi = SMOOTHING_LENGTH * min(dot(posDif,velDif), (scalar)0) / (dot(posDif,posDif) + DIST_EPSILON);
+			vector aPair = -(podsI + podsJ + f * tensile + (2*BETA_VISCOSITY*phi*phi - ALPHA_VISCOSITY*phi*(csI + csJ))*densityAdd) * gradW;
+		#else // LAMINAR (Lo & Shao 2002)
+			scalar densityAdd = 1 / (densityI + density[_j]);
+			vector aPair = -(podsI + podsJ + f * tensile) * gradW;
+			aPair += 4 * DYNAMIC_VISCOSITY * velDif * dot(gradW, posDif) * densityAdd / (dot(posDif,posDif) + DIST_EPSILON);
+		#endif
+			aI += massJ * aPair;
+
+			// XSPH, particles are corrected only by fluid neighbors
+			vector corrPair = velDif * (W * densityAdd);
+			if(fluidJ)
+			{
+				corrI += massJ * corrPair;
+				AtomicAddVector(&pairAcc[j], -massI * aPair);
+				if(fluidI)
+					AtomicAddVector(&pairCorr[j], -massI * corrPair);
+			}
+		}
+
+	ForEachEnd
+
+	if(fluidI)
+	{
+		AtomicAddVector(&pairAcc[i], aI);
+		AtomicAddVector(&pairCorr[i], corrI);
+	}
+}
@@ -8,7 +8,7 @@ __kernel void Accelerations
 	__global const vector *pos : POSITIONS,
 	__global const scalar *density : DENSITIES,
 	__global const scalar *pressure : PRESSURES,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const uint *hashes : CELLS_HASH,
 	__global const uint *particles : HASHES_PARTICLE,
 	uint particleCount : PARTICLE_COUNT,
@@ -34,7 +34,7 @@ __kernel void Accelerations
 	scalar tensileI = pressureI * (pressureI<0 ? tcEpsilon1 : tcEpsilon2);
 	
 	ForEachSetup(posI,gridStart,cellSizeInv,cellCount)
-	ForEachNeighbor(cellCount,hashes,particles,cellsStart,h)
+	ForEachNeighbor(cellCount,hashes,particles,cellRanges,h)
 		scalar pressureJ = pressure[j];
 		vector gradW = SphKernelGrad(QSq, posDif);
 	 	// tensile correction
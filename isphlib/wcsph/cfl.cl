@@ -7,7 +7,7 @@ __kernel void CflTimeStep
 	__global const vector *pos		: SORTED_POSITIONS,
 	__global const scalar *density : SORTED_DENSITIES,
 	__global const vector *acc : ACCELERATIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	uint particleCount : PARTICLE_COUNT,
 	__global scalar *dt : NEXT_TIME_STEP
@@ -23,7 +23,7 @@ __kernel void CflTimeStep
 	localSoundSpeed *= WC_SOUND_SPEED * localSoundSpeed * localSoundSpeed;
 
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,pos,posI)
 		// Find maximum of viscosity stability parameter Monaghan JWPCOE 1999
 		scalar sigma = fabs(dot(vel[_j]-velI, posDif)) / (dot(posDif, posDif) + DIST_EPSILON);
 		if(sigma > sigmaMax)
@@ -7,7 +7,7 @@ __kernel void Continuity
 	__global const vector *pos : SORTED_POSITIONS,
 	__global const scalar *mass : SORTED_MASSES,
 	__global const vector *xsphVel : XSPH_SORTED,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	uint particleCount : PARTICLE_COUNT
 )
@@ -20,7 +20,7 @@ __kernel void Continuity
 	scalar densityI = 0;
 	
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,pos,posI)
 
 		vector gradW = SphKernelGrad(QSq, posDif);
 		// Avoids pressure fluctuation at free surfaces - Monaghan 1992 ARAA
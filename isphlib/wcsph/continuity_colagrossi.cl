@@ -7,7 +7,7 @@ __kernel void Continuity
 	__global const vector *pos : POSITIONS,
 	__global const scalar *density: DENSITIES,
 	__global const vector *xsphVel : XSPH_VELOCITIES,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const uint *hashes : CELLS_HASH,
 	__global const uint *particles : HASHES_PARTICLE,
 	uint particleCount : PARTICLE_COUNT,
@@ -25,7 +25,7 @@ __kernel void Continuity
 	scalar densityI = 0;
 	
 	ForEachSetup(posI,gridStart,cellSizeInv,cellCount)
-	ForEachNeighbor(cellCount,hashes,particles,cellsStart,h)
+	ForEachNeighbor(cellCount,hashes,particles,cellRanges,h)
 		vector gradW = SphKernelGrad(QSq, posDif);
 		densityI += dot(gradW, (xsphVelI - xsphVel[j]))/density[j]; // Avoids pressure fluctuation at free surfaces - Monaghan 1992 ARAA 
 	ForEachEnd
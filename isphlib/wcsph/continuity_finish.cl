@@ -0,0 +1,16 @@
+/*!
+ *	\brief	Copy density rate of change summed by pair-wise kernel, and clear the sums
+ */
+__kernel void ContinuityFinish
+(
+	__global scalar *densityRoC : DENSITY_ROC,
+	__global scalar *pairDensityRoC : PAIR_DENSITY_ROC,
+	uint particleCount : PARTICLE_COUNT
+)
+{
+	size_t i = get_global_id(0);
+	if(i >= particleCount) return;
+
+	densityRoC[i] = pairDensityRoC[i];
+	pairDensityRoC[i] = 0;
+}
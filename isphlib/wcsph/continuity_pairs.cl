@@ -0,0 +1,37 @@
+/*!
+ *	\brief	Continuity equation term of each particle pair computed once, and added to both particles
+ *
+ *	Runs over particles in cell order. Continuity finish kernel reads the sums and clears them.
+ */
+__kernel void ContinuityPairs
+(
+	__global scalar *pairDensityRoC : PAIR_DENSITY_ROC,
+	__global const vector *pos : SORTED_POSITIONS,
+	__global const scalar *mass : SORTED_MASSES,
+	__global const vector *xsphVel : XSPH_SORTED,
+	__global const uint2 *cellRanges : CELL_RANGES,
+	__global const int2 *hashes : HASHES,
+	uint particleCount : PARTICLE_COUNT
+)
+{
+	size_t _i = get_global_id(0);
+	if(_i >= particleCount) return;
+
+	int i = hashes[_i].y;
+	vector posI = pos[_i];
+	vector xsphVelI = xsphVel[_i];
+	scalar massI = mass[_i];
+	scalar densityI = 0;
+
+	ForEachSetup(posI)
+	ForEachPairNeighbor(hashes,cellRanges,pos,posI)
+
+		// kernel gradient and velocity difference both change sign for j, so it gets the same term
+		scalar d = dot(SphKernelGrad(QSq, posDif), xsphVelI - xsphVel[_j]);
+		densityI += mass[_j] * d;
+		AtomicAddScalar(&pairDensityRoC[j], massI * d);
+
+	ForEachEnd
+
+	AtomicAddScalar(&pairDensityRoC[i], densityI);
+}
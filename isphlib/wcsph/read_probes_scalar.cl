@@ -8,8 +8,9 @@ __kernel void readProbeScalar
 	__global const vector *probesPos : PROBES_LOCATION,
 	__global scalar *buffer : PROBES_BUFFER,
 	__global const vector *pos : POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
 	__global const scalar *value : PROBES_SCALAR,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	__global uint *bufferedValues: PROBES_RECORDED_VALUES,
 	uint bufferingSteps: PROBES_BUFFERING_STEPS,
@@ -27,7 +28,7 @@ __kernel void readProbeScalar
 	scalar tmp = (scalar)0;
 	// Average value as in SPH approximation
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,sortedPos,posI)
 		//if(IsParticleFluid(j))
 			tmp += value[j] * SphKernel(QSq);
 	ForEachEnd
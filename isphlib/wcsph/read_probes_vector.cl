@@ -8,10 +8,11 @@ __kernel void readProbeVector
 	__global const vector *probesPos : PROBES_LOCATION,
 	__global scalar *buffer : PROBES_BUFFER,
 	__global const vector *pos : POSITIONS,
+	__global const vector *sortedPos : SORTED_POSITIONS,
 	__global const vector *value : PROBES_VECTOR,
 	__global const scalar *density : DENSITIES,
 	__global const scalar *mass : MASSES,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	__global uint *bufferedValues: PROBES_RECORDED_VALUES,
 	uint bufferingSteps: PROBES_BUFFERING_STEPS,
@@ -29,7 +30,7 @@ __kernel void readProbeVector
 	vector tmp = (vector)0;
 	// Average value as in SPH approximation
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,sortedPos,posI)
 		//uint j = particleJ.y;
 		//if(j < fluidParticleCount)
 			tmp +=  value[j] * SphKernel(QSq) * mass[j] / density[j];
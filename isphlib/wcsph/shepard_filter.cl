@@ -7,7 +7,7 @@ __kernel void ShepardFilter
 	__global scalar *density : DENSITIES,
 	__global const scalar *mass : SORTED_MASSES,
 	__global const vector *pos : SORTED_POSITIONS,
-	__global const uint *cellsStart : CELLS_START,
+	__global const uint2 *cellRanges : CELL_RANGES,
 	__global const int2 *hashes : HASHES,
 	uint particleCount : PARTICLE_COUNT
 )
@@ -19,7 +19,7 @@ __kernel void ShepardFilter
 	scalar weight = 0;
 
 	ForEachSetup(posI)
-	ForEachNeighbor(hashes,cellsStart,pos,posI)
+	ForEachNeighbor(hashes,cellRanges,pos,posI)
 	
 		scalar mult = SphKernel(QSq) * mass[_j];
 		densityI += mult; 
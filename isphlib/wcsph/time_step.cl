@@ -0,0 +1,16 @@
+/*!
+ *	\brief	Choose time step from CFL condition on device
+ */
+__kernel void WcsphTimeStep
+(
+	__global scalar *ts : TIME_STEPS,
+	__global scalar *nextDt : NEXT_TIME_STEP,
+	scalar wantedDt : WANTED_TIME_STEP,
+	scalar cflFactor : CFL_FACTOR
+)
+{
+	StartTimeStep(ts, wantedDt > (scalar)0 ? wantedDt : cflFactor * nextDt[0]);
+
+	// CFL kernel of next step searches for minimum again
+	nextDt[0] = (scalar)100000;
+}
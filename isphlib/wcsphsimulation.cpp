@@ -14,6 +14,8 @@ WcsphSimulation::WcsphSimulation(unsigned int simDimensions, VariableDataType sc
 	, initDensityFromPressure(false)
 	, initMassFromDensity(false)
 	, initedWcsphStuff(false)
+	, pairwiseAcceleration(false)
+	, pairwiseContinuity(false)
 	, integratorType(PredictorCorrector)
 	, integratorGridRefresh(true)
 	, viscosityFormulation(LaminarViscosity)
@@ -88,6 +90,28 @@ bool WcsphSimulation::InitSph()
    	// program build options
 	program->AddBuildOption("-D WCSPH");
 
+	if(pairwiseAcceleration && viscosityFormulation == SubParticleScaleViscosity)
+	{
+		Log::Send(Log::Warning, "Pair-wise accelerations don't support SPS viscosity. Computing them per particle.");
+		pairwiseAcceleration = false;
+	}
+
+	if(pairwiseAcceleration || pairwiseContinuity)
+	{
+		CLDevice* device = this->Devices()->Device(0);
+		if(!device->GlobalAtomics() || (this->ScalarDataType() == DoubleType && !device->GlobalAtomics64()))
+		{
+			Log::Send(Log::Warning, "Device doesn't support atomics needed for pair-wise kernels. Computing them per particle.");
+			pairwiseAcceleration = pairwiseContinuity = false;
+		}
+		else
+			program->AddBuildOption("-D PAIRWISE_ATOMICS");
+	}
+
+	this->InitSimulationBuffer("PAIR_ACCELERATIONS", this->VectorDataType(), pairwiseAcceleration ? this->deviceParticleCount : 1);
+	this->InitSimulationBuffer("PAIR_XSPH_CORRECTIONS", this->VectorDataType(), pairwiseAcceleration ? this->deviceParticleCount : 1);
+	this->InitSimulationBuffer("PAIR_DENSITY_ROC", this->ScalarDataType(), pairwiseContinuity ? this->deviceParticleCount : 1);
+
 	if (initDensityFromPressure) 
 	{
 		 // Todo need to generalize to all EOS
@@ -99,7 +123,13 @@ bool WcsphSimulation::InitSph()
          this->LoadSubprogram("set masses", "wcsph/set_masses.cl");	
 	}
 
-    this->LoadSubprogram("acceleration", "wcsph/acceleration.cl");
+	if(pairwiseAcceleration)
+	{
+		this->LoadSubprogram("acceleration pairs", "wcsph/acceleration_pairs.cl");
+		this->LoadSubprogram("acceleration finish", "wcsph/acceleration_finish.cl");
+	}
+	else
+		this->LoadSubprogram("acceleration", "wcsph/acceleration.cl");
 
 	switch(densityReinitMethod)
 	{
@@ -119,8 +149,15 @@ bool WcsphSimulation::InitSph()
 	}
 
 	this->LoadSubprogram("wcsph init", "wcsph/init.cl");
-    this->LoadSubprogram("continuity", "wcsph/continuity.cl");
+	if(pairwiseContinuity)
+	{
+		this->LoadSubprogram("continuity pairs", "wcsph/continuity_pairs.cl");
+		this->LoadSubprogram("continuity finish", "wcsph/continuity_finish.cl");
+	}
+	else
+		this->LoadSubprogram("continuity", "wcsph/continuity.cl");
 	this->LoadSubprogram("cfl", "wcsph/cfl.cl");
+	this->LoadSubprogram("time step", "wcsph/time_step.cl");
 	this->LoadSubprogram("eos", "wcsph/tait_eos.cl");
 
 
@@ -160,6 +197,27 @@ bool WcsphSimulation::PostInitSph()
          this->EnqueueSubprogram("set masses");	
 	}
 
+	// time step kernel resets it after reading
+	program->Buffer("NEXT_TIME_STEP")->SetScalar(100000.0);
+
+	// pair-wise kernels add to sums, that finish kernels clear after reading
+	if(pairwiseAcceleration)
+	{
+		CLGlobalBuffer* acc = program->Buffer("PAIR_ACCELERATIONS");
+		CLGlobalBuffer* corr = program->Buffer("PAIR_XSPH_CORRECTIONS");
+		for(unsigned int i=0; i<acc->Elements(); i++)
+		{
+			acc->SetVector(i, Vec<3,double>(0.0));
+			corr->SetVector(i, Vec<3,double>(0.0));
+		}
+	}
+	if(pairwiseContinuity)
+	{
+		CLGlobalBuffer* densityRoC = program->Buffer("PAIR_DENSITY_ROC");
+		for(unsigned int i=0; i<densityRoC->Elements(); i++)
+			densityRoC->SetScalar(i, 0.0);
+	}
+
     if(!program->Finish())
 	{
 		Log::Send(Log::Error, "Post initialization operation failed.");
@@ -172,17 +230,35 @@ bool WcsphSimulation::PostInitSph()
 void WcsphSimulation::CalculateDerivatives()
 {
 	// calculate particle accelerations
-	this->EnqueueSubprogram("acceleration");
+	if(pairwiseAcceleration)
+	{
+		this->EnqueueSubprogram("acceleration pairs");
+		this->EnqueueSubprogram("acceleration finish");
+	}
+	else
+		this->EnqueueSubprogram("acceleration");
 
 	// calculate density rate of change with continuity eq.
-	this->EnqueueSubprogram("continuity");
+	if(pairwiseContinuity)
+	{
+		this->EnqueueSubprogram("continuity pairs");
+		this->EnqueueSubprogram("continuity finish");
+	}
+	else
+		this->EnqueueSubprogram("continuity");
+}
+
+
+unsigned int WcsphSimulation::StepVariant()
+{
+	return densityReinitMethod != None && ((this->timeStepCount + 1) % densityReinitFrequency) == 0;
 }
 
 
 bool WcsphSimulation::RunSph()
 {
 	// density reinit this step needed
-	bool doDensityReinit = densityReinitMethod != None && ((this->timeStepCount + 1) % densityReinitFrequency) == 0;
+	bool doDensityReinit = StepVariant() != 0;
 
 	// copy buffers since we used XSPH_VELOCITIES as a temp buffer
 	program->Buffer("VELOCITIES_TMP")->CopyFrom(program->Buffer("VELOCITIES"), false);
@@ -240,6 +316,16 @@ double WcsphSimulation::SuggestTimeStep()
 }
  
 
+bool WcsphSimulation::EnqueueTimeStep(bool automatic)
+{
+	// find minimum required next time step, without reading it back
+	if(automatic && !this->EnqueueSubprogram("cfl"))
+		return false;
+
+	return Simulation::EnqueueTimeStep(automatic);
+}
+
+
 bool WcsphSimulation::UploadModifiedBuffers()
 {
 	bool success = Simulation::UploadModifiedBuffers();
@@ -285,6 +371,16 @@ void WcsphSimulation::SetIntegratorGridRefreshing( bool enable )
 	integratorGridRefresh = enable;
 }
 
+void WcsphSimulation::SetPairwiseAcceleration( bool enable )
+{
+	pairwiseAcceleration = enable;
+}
+
+void WcsphSimulation::SetPairwiseContinuity( bool enable )
+{
+	pairwiseContinuity = enable;
+}
+
 bool WcsphSimulation::AddIntegrationStep( const std::string& subprogram )
 {
 	integrationStepSubprograms.push_back(subprogram);
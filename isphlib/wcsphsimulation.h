@@ -188,6 +188,31 @@ namespace isph {
 		 */
 		inline void SetInitMassFromDensity(bool enable) { initMassFromDensity = enable; }
 
+		/*!
+		 *	\brief	Set whether accelerations and XSPH corrections are computed once per particle pair. Disabled by default.
+		 *
+		 *	Each pair is evaluated once, and its terms added to both particles with atomics. Needs device support
+		 *	for global atomics (64-bit for double precision), and is not used with SPS viscosity.
+		 */
+		void SetPairwiseAcceleration(bool enable);
+
+		/*!
+		 *	\brief	Get whether accelerations are computed once per particle pair.
+		 */
+		inline bool PairwiseAcceleration() { return pairwiseAcceleration; }
+
+		/*!
+		 *	\brief	Set whether density rate of change is computed once per particle pair. Disabled by default.
+		 *
+		 *	Needs the same device support as pair-wise accelerations.
+		 */
+		void SetPairwiseContinuity(bool enable);
+
+		/*!
+		 *	\brief	Get whether density rate of change is computed once per particle pair.
+		 */
+		inline bool PairwiseContinuity() { return pairwiseContinuity; }
+
 		/*!
 		 *	\brief	Suggest next time step based on CFL condition, Monaghan & Kos (1999).
 		 *	\return	Time in seconds.
@@ -216,6 +241,8 @@ namespace isph {
 		virtual bool InitSph();
 		virtual bool PostInitSph();
 		virtual bool RunSph();
+		virtual bool EnqueueTimeStep(bool automatic);
+		virtual unsigned int StepVariant();
 		void CalculateDerivatives();
 
 		double wcGamma;
@@ -228,6 +255,10 @@ namespace isph {
 		bool initMassFromDensity;
 		bool initedWcsphStuff;
 
+		// kernels that compute each particle pair once
+		bool pairwiseAcceleration;
+		bool pairwiseContinuity;
+
 		// viscosity
 		ViscosityFormulationType viscosityFormulation;
 		double alphaViscosity;
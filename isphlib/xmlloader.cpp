@@ -271,6 +271,14 @@ Simulation* XmlLoader::Read()
 		bool initMassFromDensity = xmlMassInitFromDensity ? ParseBoolean(xmlMassInitFromDensity) : false;
 		wcsphSim->SetInitMassFromDensity(initMassFromDensity);
 
+		// kernels that compute each particle pair once
+		xml_node xmlPairwise = xmlSolver.child("pairwise_kernels");
+		if(xmlPairwise)
+		{
+			wcsphSim->SetPairwiseAcceleration(xmlPairwise.attribute("acceleration").as_bool());
+			wcsphSim->SetPairwiseContinuity(xmlPairwise.attribute("continuity").as_bool());
+		}
+
 	}
 	else if(solverType == "isph")
 	{
@@ -286,6 +294,11 @@ Simulation* XmlLoader::Read()
 			isphSim->SetStrongDirichletBC(dbc.at(0)=='s' || dbc.at(0)=='S' ? true : false);
 		}
 
+		// kernels that compute each particle pair once
+		xml_node xmlPairwise = xmlSolver.child("pairwise_kernels");
+		if(xmlPairwise)
+			isphSim->SetPairwisePressureGradient(xmlPairwise.attribute("pressure_gradient").as_bool());
+
 		// particle shifting
 		xml_node xmlShift = xmlSolver.child("particle_shifting");
 		if(xmlShift)
@@ -317,6 +330,8 @@ Simulation* XmlLoader::Read()
 				isphSim->SetSolver(CG);
 			else if(solverName == "bicgstab")
 				isphSim->SetSolver(BiCGSTAB);
+			else if(solverName == "pipelined_cg")
+				isphSim->SetSolver(PipelinedCG);
 			else
 				Log::Send(Log::Warning, "PPE solver method '" + solverName + "' not supported, using default.");
 
@@ -335,6 +350,45 @@ Simulation* XmlLoader::Read()
 			xml_node xmlSolvingTolerance = xmlPPESolver.child("tolerance");
 			if (xmlSolvingTolerance)
 				isphSim->SetSolverTolerance(ParseScalar(xmlSolvingTolerance));
+
+			// assembled or matrix-free
+			std::string matrixName(xmlPPESolver.attribute("matrix").value());
+			if(matrixName == "free")
+				isphSim->SetAssembledMatrix(false);
+			else if(matrixName == "assembled")
+				isphSim->SetAssembledMatrix(true);
+			else if(!matrixName.empty())
+				Log::Send(Log::Warning, "PPE matrix form '" + matrixName + "' not supported, using default.");
+
+			// preconditioner
+			std::string precondName(xmlPPESolver.attribute("preconditioner").value());
+			if(precondName == "jacobi")
+				isphSim->SetPreconditioner(JacobiPreconditioner);
+			else if(precondName == "multigrid")
+				isphSim->SetPreconditioner(MultigridPreconditioner);
+			else if(precondName == "none")
+				isphSim->SetPreconditioner(NoPreconditioner);
+			else if(!precondName.empty())
+				Log::Send(Log::Warning, "PPE preconditioner '" + precondName + "' not supported, using none.");
+
+			// previous pressure as initial guess
+			xml_node xmlWarmStart = xmlPPESolver.child("warm_start");
+			if (xmlWarmStart)
+				isphSim->SetWarmStart(xmlWarmStart.attribute("enable").as_bool() || ParseBoolean(xmlWarmStart));
+
+			// single precision solver refined in double precision
+			xml_node xmlMixedPrecision = xmlPPESolver.child("mixed_precision");
+			if (xmlMixedPrecision)
+			{
+				isphSim->SetMixedPrecision(xmlMixedPrecision.attribute("enable").as_bool() || ParseBoolean(xmlMixedPrecision));
+				if(!xmlMixedPrecision.attribute("max_refinements").empty())
+					isphSim->SetMaxRefinements(xmlMixedPrecision.attribute("max_refinements").as_uint());
+			}
+
+			// solver scalars on device, with periodic convergence check
+			xml_node xmlDeviceScalars = xmlPPESolver.child("device_scalars");
+			if (xmlDeviceScalars)
+				isphSim->SetDeviceSolverScalars(xmlDeviceScalars.attribute("enable").as_bool() || ParseBoolean(xmlDeviceScalars), xmlDeviceScalars.attribute("check_interval").as_uint(5));
 		}
 	}
 	else
@@ -349,10 +403,41 @@ Simulation* XmlLoader::Read()
 	// set running info
 	xml_node xmlTimeStep = xmlSim.child("time_step");
 	sim->SetRunTime(ParseScalar(xmlSim.child("run_time")), ParseScalar(xmlTimeStep), xmlTimeStep.attribute("auto_factor").as_double(1.0));
+	sim->SetTimeSyncInterval(xmlTimeStep.attribute("sync_interval").as_uint(sim->TimeSyncInterval()));
 
 	// export management
 	sim->SetAsyncExport(asyncOutput);
 
+	// keep neighbor data in cell order
+	xml_node xmlReorder = xmlSolver.child("particle_reordering");
+	if(xmlReorder)
+		sim->SetParticleReordering(xmlReorder.attribute("enable").as_bool() || ParseBoolean(xmlReorder));
+
+	// hash grid cells in Z-order
+	xml_node xmlMorton = xmlSolver.child("morton_cells");
+	if(xmlMorton)
+		sim->SetMortonCellOrder(xmlMorton.attribute("enable").as_bool() || ParseBoolean(xmlMorton));
+
+	// keep only occupied grid cells
+	xml_node xmlSparse = xmlSolver.child("sparse_grid");
+	if(xmlSparse)
+		sim->SetSparseGrid(xmlSparse.attribute("enable").as_bool() || ParseBoolean(xmlSparse));
+
+	// sort only particles that changed cell
+	xml_node xmlIncremental = xmlSolver.child("incremental_sort");
+	if(xmlIncremental)
+		sim->SetIncrementalSort(xmlIncremental.attribute("enable").as_bool() || ParseBoolean(xmlIncremental));
+
+	// run supported neighbor kernels one work-group per grid cell
+	xml_node xmlTiled = xmlSolver.child("tiled_kernels");
+	if(xmlTiled)
+		sim->SetTiledKernels(xmlTiled.attribute("enable").as_bool() || ParseBoolean(xmlTiled));
+
+	// store neighbors in Verlet lists
+	xml_node xmlNeighborLists = xmlSolver.child("neighbor_lists");
+	if(xmlNeighborLists)
+		sim->SetNeighborLists(xmlNeighborLists.attribute("enable").as_bool() || ParseBoolean(xmlNeighborLists), xmlNeighborLists.attribute("skin").as_double(0.1));
+
 	for (xml_node xmlExport = xmlSim.child("export"); xmlExport; xmlExport = xmlExport.next_sibling("export"))
 	{
 		Writer* writer;
@@ -458,6 +543,10 @@ Simulation* XmlLoader::Read()
 	else // by default take the first device in list
 		sim->SetDevices(new CLLink(devs[0]));
 
+	// reuse program binaries compiled by earlier runs
+	if(!xmlDevices.attribute("binary_cache").empty())
+		sim->SetProgramCache(xmlDevices.attribute("binary_cache").value());
+
 
 	// boundary options
 
@@ -511,6 +600,10 @@ Simulation* XmlLoader::Read()
 			sim->SetSmoothingKernel(CubicSplineKernel, h, kernelCorr);
 			Log::Send(Log::Warning, "Smoothing kernel '" + kernelType + "' not supported. Cubic spline kernel will be used.");
 		}
+
+		// interpolate kernel and gradient from sampled tables
+		if(!xmlKernel.attribute("tabulated").empty())
+			sim->SetTabulatedKernel(xmlKernel.attribute("tabulated").as_bool(), xmlKernel.attribute("table_samples").as_uint(2048));
 	}
 
 	// fluid(s)